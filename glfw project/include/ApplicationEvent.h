@@ -3,6 +3,7 @@
 #include "Event.h"
 
 #include <cstdint>
+#include <string>
 
 
 class WindowResizeEvent : public Event
@@ -20,3 +21,20 @@ private:
 	uint32_t m_width;
 	uint32_t m_height;
 };
+
+
+//published on the main thread by the AssetWatcher when a watched file has been modified on disk
+class AssetChangedEvent : public Event
+{
+public:
+	virtual ~AssetChangedEvent() {};
+	AssetChangedEvent(const std::string& a_path) : m_path(a_path) {}
+
+	static constexpr DescriptorType descriptor = "AssetChangedEvent";
+	virtual DescriptorType type() const { return descriptor; }
+	//normalised absolute path of the file that changed (see Utility::normalisePath)
+	inline const std::string& GetPath() { return m_path; }
+
+private:
+	std::string m_path;
+};
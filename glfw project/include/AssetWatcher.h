@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+//the asset watcher monitors files and directories on a background thread and reports any files that
+//have been modified. On linux inotify is used, on other platforms file modification times are polled.
+//Changes are queued by the background thread and published as AssetChangedEvents on the main thread
+//from Update() so handlers are free to make GL calls
+class AssetWatcher
+{
+public:
+	static AssetWatcher* CreateInstance();
+	static AssetWatcher* GetInstance();
+	static void DestroyInstance();
+
+	//watch every file in a directory, optionally including sub directories
+	void WatchDirectory(const std::string& a_directory, bool a_recursive);
+	//watch a single file
+	void WatchFile(const std::string& a_filename);
+
+	//publish an AssetChangedEvent for each file that has changed since the last call
+	void Update();
+
+private:
+	static AssetWatcher* m_instance;
+
+	AssetWatcher();
+	~AssetWatcher();
+
+	void WatchThread();
+	void QueueChange(const std::string& a_path);
+
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+
+	//guards everything below, shared between the main thread and the watch thread
+	std::mutex m_mutex;
+	std::vector<std::pair<std::string, bool>> m_directories;
+	std::set<std::string> m_files;
+	std::set<std::string> m_changed;
+	//set when a new directory or file has been added and the watch thread needs to pick it up
+	bool m_watchListDirty;
+
+#ifdef __linux__
+	int m_inotifyHandle;
+	std::map<int, std::string> m_watchDescriptors;
+#endif
+};
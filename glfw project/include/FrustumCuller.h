@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//tests world space bounding boxes against the six planes of the camera's frustum. The boxes are stored as separate
+//arrays of each component so four of them are tested at once with SSE, a box is only culled when it is entirely
+//behind one of the planes, so a few boxes near the corners of the frustum are kept when they could have been culled
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	//extract the planes from a projection view matrix, a point is inside when it is in front of all of them
+	void SetFrustum(const glm::mat4& a_projectionView);
+
+	void Clear();
+	//add the world space box around a model space box under a transform, returns the index of the box
+	unsigned int AddBounds(const glm::vec3& a_centre, const glm::vec3& a_extents, const glm::mat4& a_transform);
+	//test every box added since the last clear, returns how many are at least partly inside the frustum
+	unsigned int Cull();
+
+	bool IsVisible(unsigned int a_index) const { return m_visible[a_index] != 0; }
+	//the world space centre and half size of a box
+	void GetBounds(unsigned int a_index, glm::vec3& a_centre, glm::vec3& a_extents) const;
+	unsigned int GetBoundsCount() const { return m_count; }
+
+private:
+	glm::vec4 m_planes[6];
+	//box centres and half sizes, padded to a multiple of four boxes when they are culled
+	std::vector<float> m_centreX, m_centreY, m_centreZ;
+	std::vector<float> m_extentX, m_extentY, m_extentZ;
+	std::vector<unsigned char> m_visible;
+	unsigned int m_count;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <map>
+#include <string>
+
+//the memory tracker keeps a running tally of how many bytes of CPU and GPU memory are owned by each loaded model
+//allocations are tagged with a category and an owner (usually a model file) so totals can be broken down either way
+class MemoryTracker
+{
+public:
+	//categories of memory that are accounted for
+	enum Category
+	{
+		MeshData = 0,	//CPU - OBJMesh vertex and index vectors
+		MaterialData,	//CPU - OBJMaterial data and texture file names
+		TextureData,	//GPU - texture storage including the mip chain
+		ShaderData,		//GPU - linked shader program binaries
+		BufferData,		//GPU - vertex and index buffers
+
+		Category_Count
+	};
+
+	//record of the memory owned by a single owner, indexed by category
+	typedef struct OwnerRecord
+	{
+		size_t bytes[Category_Count];
+	}OwnerRecord;
+
+	//this manager class will act as a singleton object for ease of access
+	static MemoryTracker* CreateInstance();
+	static MemoryTracker* GetInstance();
+	static void DestroyInstance();
+
+	//add or remove bytes for an owner, these are safe to call when no tracker instance exists
+	static void Allocate(Category a_category, const std::string& a_owner, size_t a_bytes);
+	static void Free(Category a_category, const std::string& a_owner, size_t a_bytes);
+
+	//query functions for the totals
+	size_t GetCategoryTotal(Category a_category) const { return m_categoryTotals[a_category]; }
+	size_t GetOwnerTotal(const std::string& a_owner) const;
+	size_t GetOwnerCategoryTotal(const std::string& a_owner, Category a_category) const;
+	size_t GetCPUTotal() const;
+	size_t GetGPUTotal() const;
+	const std::map<std::string, OwnerRecord>& GetOwners() const { return m_owners; }
+
+	//helper functions for display
+	static bool IsGPUCategory(Category a_category) { return a_category == TextureData || a_category == ShaderData || a_category == BufferData; }
+	static const char* GetCategoryName(Category a_category);
+	static std::string FormatBytes(size_t a_bytes);
+
+private:
+	static MemoryTracker* m_instance;
+
+	size_t m_categoryTotals[Category_Count];
+	std::map<std::string, OwnerRecord> m_owners;
+
+	MemoryTracker();
+	~MemoryTracker();
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <vector>
+
+class OBJMesh;
+
+//copies of the vertex and index data of meshes in a few large shared buffers so many meshes can be drawn with one
+//glMultiDrawElementsIndirect call. There is one vertex buffer and an index buffer for each index size, a mesh is
+//found in them by the base vertex and first index stored on it. Data is copied on the GPU from the mesh's own
+//buffers, so spilled meshes are pooled without reading them back in, and the buffers grow as meshes are added
+class MeshPool
+{
+public:
+	//the vertex arrays read a mat4 per instance from a_instanceBinding into four locations from a_instanceLocation
+	MeshPool(unsigned int a_instanceLocation, unsigned int a_instanceBinding);
+	~MeshPool();
+
+	//copy an uploaded mesh into the pool, returns false if it is already pooled or has nothing to draw
+	bool AddMesh(OBJMesh* a_pMesh);
+	void RemoveMesh(OBJMesh* a_pMesh);
+	//remove every mesh and release the buffers
+	void Clear();
+
+	unsigned int GetMeshCount() const { return (unsigned int)m_meshes.size(); }
+	//vertex array reading the pooled vertices and the index buffer of one index size
+	unsigned int GetVertexArrayID(bool a_shortIndices) const { return m_vertexArrays[a_shortIndices ? 1 : 0]; }
+	size_t GetMemoryUsage() const;
+
+private:
+	//one shared buffer, space is handed out in whole elements so offsets can be used as the base vertex and first index
+	typedef struct PoolBuffer
+	{
+		unsigned int bufferID;
+		size_t elementSize;
+		size_t capacity;						//in elements
+		std::map<size_t, size_t> freeRanges;	//first element of each free range to its element count
+	}PoolBuffer;
+
+	bool Allocate(PoolBuffer& a_buffer, size_t a_count, size_t& a_offset);
+	void Free(PoolBuffer& a_buffer, size_t a_offset, size_t a_count);
+	//replace the buffer with one of at least a_minCapacity elements, copying the pooled data across
+	void Grow(PoolBuffer& a_buffer, size_t a_minCapacity);
+	void Release(PoolBuffer& a_buffer);
+	void UpdateVertexArrays();
+
+	unsigned int m_instanceLocation;
+	unsigned int m_instanceBinding;
+	PoolBuffer m_vertices;
+	PoolBuffer m_indices[2];	//32 and 16 bit indices
+	unsigned int m_vertexArrays[2];
+	std::vector<OBJMesh*> m_meshes;
+};
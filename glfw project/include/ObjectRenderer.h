@@ -11,6 +11,14 @@
 
 //forward declare OBJ model
 class OBJModel;
+class OBJMesh;
+class Texture;
+class ShaderProgram;
+class UniformRingBuffer;
+class MeshPool;
+class RenderQueue;
+class FrustumCuller;
+class OcclusionCuller;
 
 class ObjectRenderer : public Application
 {
@@ -19,6 +27,7 @@ public:
 	virtual ~ObjectRenderer();
 
 	void onWindowResize(WindowResizeEvent* e);
+	void onAssetChanged(AssetChangedEvent* e);
 
 protected:
 	virtual bool onCreate();
@@ -27,42 +36,210 @@ protected:
 	virtual void UpdateGUI();
 	virtual int GetActorIndex(std::string _actor);
 	virtual void LoadModel(std::string _filename);
+	virtual void UploadModel(OBJModel* _model, std::string _owner);
+	virtual void UploadMesh(OBJMesh* _mesh);
+	//point the per instance transform attributes of the bound vertex array at the instance binding
+	virtual void SetupInstanceAttributes();
+	//upload the colours of every material of a model into one uniform buffer, one aligned range per material
+	virtual void UploadMaterials(OBJModel* _model, std::string _owner);
+	virtual void UnloadModel(OBJModel* _model, std::string _owner);
+	//copy every loaded mesh into the shared mesh pool when multi-draw is enabled, or empty the pool when it isn't
+	virtual void UpdateMeshPool();
+	//submit the draws batched for multi-draw this frame, the instance transforms start at _instanceOffset in the frame buffer
+	virtual void SubmitDrawBatches(size_t _instanceOffset);
+	virtual void LoadModelMaterials(OBJModel* _model, std::string _owner);
+	virtual void ReleaseModelTextures(OBJModel* _model);
+	virtual void ReloadModel(OBJModel* _model, std::string _filename);
+	//tell the texture manager which mip level of a mesh's textures is needed from how large it is on screen
+	virtual void RequestTextureDetail(const OBJMesh* _mesh, const glm::mat4& _transform, float _scale);
+	//rebuild the cached matrices of the actors that were changed since they were last built
+	virtual void UpdateActorMatrices();
+	//read back the overdraw measured in an earlier frame and decide whether the automatic depth prepass should run
+	virtual void UpdateDepthPrepass();
 	virtual void Draw();
 	virtual void Destroy();
 
 private:
-	//structure for a simple vertex - interleaved (position, colour)
-	typedef struct Vertex
+	//whether the depth prepass runs, automatic decides from the measured overdraw and the triangles drawn
+	enum DepthPrepassMode
 	{
-		glm::vec4 position;
-		glm::vec4 colour;
-	}Vertex;
+		PrepassOff = 0,
+		PrepassOn,
+		PrepassAuto
+	};
+	//samples passed queries in flight, results are read a couple of frames after they are issued
+	static const unsigned int OverdrawQueryCount = 3;
+
+	//std140 layouts of the uniform blocks read by the OBJ shaders, and the binding point of each block
+	enum UniformBlockBinding
+	{
+		FrameBlock = 0,
+		MaterialBlock
+	};
+
+	//passes of the render queue, the pass is the most significant part of a draw's sort key
+	enum RenderPass
+	{
+		OpaquePass = 0
+	};
+
+	//a mesh drawn once for every actor using its model, the render queue orders these by their sort keys
+	typedef struct DrawItem
+	{
+		OBJMesh* mesh;
+		unsigned int firstInstance;
+		unsigned int instanceCount;
+		bool useArrays;
+		unsigned int textureIDs[3];	//diffuse, specular and normal textures, or the arrays holding them
+		int textureLayers[3];
+		unsigned int materialBuffer;
+		unsigned int materialOffset;
+	}DrawItem;
+
+	//the actors a mesh is drawn for this frame, first is the first of their consecutive transforms in the frame's
+	//transforms and visibleStart the first of their indices into the model's actors
+	typedef struct MeshInstances
+	{
+		unsigned int first;
+		unsigned int count;
+		unsigned int visibleStart;
+	}MeshInstances;
 
-	typedef struct Line
+	//a mesh of an actor that could hide others, screenSize is roughly the fraction of the screen height it covers
+	typedef struct Occluder
 	{
-		Vertex v0;
-		Vertex v1;
-	}Line;
+		float screenSize;
+		OBJMesh* mesh;
+		size_t transform;
+		//the mesh's bounds, which aren't tested against the depth the occluder wrote itself
+		unsigned int bounds;
+	}Occluder;
+
+	typedef struct FrameUniforms
+	{
+		glm::mat4 projectionViewMatrix;
+		glm::vec4 cameraPosition;
+		glm::vec4 lightDirection;
+	}FrameUniforms;
+
+	typedef struct MaterialUniforms
+	{
+		glm::vec4 kA;
+		glm::vec4 kD;
+		glm::vec4 kS;
+	}MaterialUniforms;
+
+	//a glMultiDrawElementsIndirect command, laid out the way the GL reads it from the indirect buffer
+	typedef struct DrawElementsIndirectCommand
+	{
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	}DrawElementsIndirectCommand;
+
+	//std430 layout of the per draw data read by the multi-draw shader
+	typedef struct DrawUniforms
+	{
+		glm::vec4 kA;
+		glm::vec4 kD;
+		glm::vec4 kS;
+		glm::ivec4 textureLayers;
+	}DrawUniforms;
+
+	//pooled meshes that can be drawn with one multi-draw call as they read the same texture arrays and index size
+	typedef struct DrawBatch
+	{
+		unsigned int arrayIDs[3];	//diffuse, specular and normal texture arrays, 0 where no draw has the texture
+		bool shortIndices;
+		std::vector<DrawElementsIndirectCommand> commands;
+		std::vector<DrawUniforms> draws;
+	}DrawBatch;
 
 	glm::mat4 m_cameraMatrix;
 	glm::mat4 m_projectionMatrix;
 
 	//shader programs
-	unsigned int m_uiProgram;
-	unsigned int m_objProgram;
-	unsigned int m_lineVBO;
-	unsigned int m_objModelBuffer[2];
+	ShaderProgram* m_gridProgram;
+	ShaderProgram* m_objProgram;
+	ShaderProgram* m_objArrayProgram;
+	ShaderProgram* m_objMultiDrawProgram;
+	ShaderProgram* m_objDepthProgram;
+	//empty vertex array the full screen grid triangle is drawn with
+	unsigned int m_gridVAO;
+	//per frame uniform data and per instance transforms, rewritten every frame
+	UniformRingBuffer* m_frameUniforms;
+	//draw calls issued for the OBJ meshes last frame, and how many draws were made by multi-draw calls
+	unsigned int m_meshDrawCalls;
+	unsigned int m_indirectDraws;
+	//shared copies of the meshes, the batches built from them each frame and the buffer their commands are written to
+	MeshPool* m_meshPool;
+	std::vector<DrawBatch> m_drawBatches;
+	UniformRingBuffer* m_drawCommands;
+	//the draws of the frame that aren't multi-drawn and the queue sorting them
+	std::vector<DrawItem> m_drawItems;
+	RenderQueue* m_renderQueue;
+	//mesh bounds tested against the frustum last frame, how many were culled and how long testing took
+	FrustumCuller* m_frustumCuller;
+	unsigned int m_testedMeshes;
+	unsigned int m_culledMeshes;
+	float m_cullTime;
+	//the software depth buffer meshes are tested against after frustum culling, how many meshes were drawn into it
+	//last frame, how many were hidden by them and how long drawing and testing took
+	OcclusionCuller* m_occlusionCuller;
+	unsigned int m_occluderCount;
+	unsigned int m_occludedMeshes;
+	float m_occlusionTime;
+	//overdraw measured from the queries, the triangles the prepass draws, and whether it ran last frame
+	unsigned int m_overdrawQueries[OverdrawQueryCount];
+	bool m_overdrawQueryPending[OverdrawQueryCount];
+	unsigned int m_overdrawQueryIndex;
+	float m_overdraw;
+	unsigned int m_prepassTriangles;
+	bool m_depthPrepassActive;
+	//the automatic setting's current decision
+	bool m_depthPrepassAuto;
+	//material colours used by meshes that don't have a material
+	unsigned int m_defaultMaterialUBO;
 
 	//model
 	OBJModel* m_objModel;
-	Line* lines;
 	std::vector<OBJModel*> m_actorModels;
+	//every model that has been loaded along with the file it was loaded from, actors reference these
+	std::vector<std::pair<OBJModel*, std::string>> m_loadedModels;
+
+	//out-of-core loading settings for the load model panel
+	bool m_outOfCoreEnabled;
+	int m_outOfCoreMemoryCapMB;
+	//split meshes that are too large for 16 bit indices when loading
+	bool m_splitMeshesEnabled;
+	//read and write the compressed geometry cache when loading
+	bool m_geometryCacheEnabled;
+	//compress the textures of newly loaded models
+	bool m_textureCompressionEnabled;
+	//texture mip streaming settings
+	bool m_textureStreamingEnabled;
+	int m_textureStreamingBudgetKB;
+	//draw materials from texture arrays when all of their textures have been packed into them
+	bool m_textureArraysEnabled;
+	//memory the textures can use before unused ones are evicted
+	int m_textureMemoryBudgetMB;
+	//draw pooled meshes whose textures are in texture arrays with glMultiDrawElementsIndirect
+	bool m_multiDrawEnabled;
+	//skip meshes whose bounds are outside the view frustum
+	bool m_frustumCullingEnabled;
+	//skip meshes hidden behind the largest meshes on screen
+	bool m_occlusionCullingEnabled;
+	//lay down depth with a position only pass before shading, one of DepthPrepassMode
+	int m_depthPrepassMode;
 
 	//skybox
+	Texture* m_skyboxTexture;
 	unsigned int m_CubeMapTexID;
 	unsigned int m_SBVAO;
 	unsigned int m_SBVBO;
-	unsigned int m_SBProgramID;
+	ShaderProgram* m_SBProgram;
 
 	glm::vec3 m_backgroundColour;
 
@@ -87,11 +264,15 @@ private:
 	std::vector<std::vector<float>> m_actorPosition;
 	std::vector<std::vector<float>> m_actorRotation;
 	std::vector<float> m_actorScale;
+	//world matrix of each actor, cached and only rebuilt when its position, rotation or scale changes
+	std::vector<glm::mat4> m_actorWorldMatrix;
+	std::vector<bool> m_actorMatrixDirty;
 
 	ImGui::FileBrowser m_fileDialog;
 	std::string m_currentFile;
 
 	bool m_skyboxEnabled;
 	bool m_frameDataEnabled;
+	bool m_memoryPanelEnabled;
 	bool m_gridLinesEnabled;
 };
\ No newline at end of file
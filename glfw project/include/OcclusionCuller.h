@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//a small software depth buffer that large meshes are drawn into each frame so the bounds of every other mesh can be
+//tested against it before they are submitted. Everything runs on the CPU, the buffer is split into bands of rows
+//that are rasterized on the thread pool and every band keeps the farthest depth of each tile as a coarse level
+//so most boxes are decided without reading individual pixels
+class OcclusionCuller
+{
+public:
+	//the size of the depth buffer, rounded up to whole tiles
+	OcclusionCuller(unsigned int a_width = 256, unsigned int a_height = 128);
+
+	//clear the depth buffer and the occluders and set the matrix the next ones are drawn with
+	void BeginFrame(const glm::mat4& a_projectionView);
+	//queue a list of model space triangles to be drawn under a transform, triangles that cross the near plane are
+	//left out as they can't be projected, which only means they hide nothing
+	void AddOccluder(const std::vector<glm::vec3>& a_triangles, const glm::mat4& a_transform);
+	//draw the queued occluders into the depth buffer and build the tile level
+	void Rasterize();
+	//false if a world space box is entirely behind what has been drawn, boxes crossing the near plane are always visible
+	bool IsVisible(const glm::vec3& a_centre, const glm::vec3& a_extents) const;
+
+	unsigned int GetWidth() const { return m_width; }
+	unsigned int GetHeight() const { return m_height; }
+	unsigned int GetTriangleCount() const { return (unsigned int)m_triangles.size(); }
+	//depth of each pixel from 0 at the near plane to 1 at the far plane, rows start at the bottom of the screen
+	const float* GetDepthBuffer() const { return m_depth.data(); }
+
+private:
+	//a triangle in pixel coordinates with a depth at each corner
+	typedef struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+		float minY, maxY;
+	}ScreenTriangle;
+
+	void RasterizeBand(unsigned int a_band);
+	void RasterizeTriangle(const ScreenTriangle& a_triangle, unsigned int a_minRow, unsigned int a_maxRow);
+
+	unsigned int m_width;
+	unsigned int m_height;
+	unsigned int m_tilesWide;
+	unsigned int m_tilesHigh;
+	glm::mat4 m_projectionView;
+	std::vector<ScreenTriangle> m_triangles;
+	std::vector<float> m_depth;
+	//farthest depth in each tile
+	std::vector<float> m_tileDepth;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+
+//a persistently mapped pixel unpack buffer used as a ring of staging memory for texture uploads
+//worker threads write pixel data straight into an allocation, the main thread then issues the texture upload
+//from the buffer and releases the allocation. The space is reused once a fence shows the GPU has read it
+class PixelUploadBuffer
+{
+public:
+	PixelUploadBuffer();
+	~PixelUploadBuffer();
+
+	bool Create(size_t a_capacity);
+	void Destroy();
+
+	unsigned int GetBufferID() const { return m_bufferID; }
+	size_t GetCapacity() const { return m_capacity; }
+
+	//reserve space for a_bytes of pixel data, returns false if there isn't enough free space until earlier
+	//uploads have completed. The returned pointer may be written to from any thread
+	bool Allocate(size_t a_bytes, size_t& a_offset, void*& a_pData);
+	//call once the commands that read the allocation at a_offset have been issued (main thread only)
+	void Release(size_t a_offset);
+	//reclaim the space of released allocations that the GPU has finished reading (main thread only)
+	void Update();
+
+private:
+	//a live allocation, fence is the GLsync inserted when it was released or null until then
+	typedef struct Region
+	{
+		size_t offset;
+		size_t size;
+		void* fence;
+	}Region;
+
+	unsigned int m_bufferID;
+	size_t m_capacity;
+	unsigned char* m_pData;
+	//live allocations in the order they were made, space is reclaimed from the front
+	std::deque<Region> m_regions;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+//the draws of a frame ordered by a 64 bit sort key so consecutive draws share as much GL state as possible
+//from the most to the least significant bits a key holds the pass, the program, the material state and a depth
+//bucket, so draws are grouped by the most expensive state to change first and drawn front to back within a group
+class RenderQueue
+{
+public:
+	//a queued draw, the index refers to whatever the caller keeps about the draw
+	typedef struct Item
+	{
+		uint64_t key;
+		unsigned int index;
+	}Item;
+
+	//largest values that fit in each field of the key, larger values are clamped
+	static const unsigned int MaxPass = 0xF;
+	static const unsigned int MaxProgram = 0xF;
+	static const unsigned int MaxState = 0xFFFFFF;
+
+	//build a key, a_depth is a distance from the camera and only its rough size is kept
+	static uint64_t MakeKey(unsigned int a_pass, unsigned int a_program, unsigned int a_state, float a_depth);
+
+	void Clear() { m_items.clear(); }
+	void Push(uint64_t a_key, unsigned int a_index);
+	//sort the items into ascending key order, keeping the order items were pushed in for equal keys
+	void Sort();
+
+	bool IsEmpty() const { return m_items.empty(); }
+	const std::vector<Item>& GetItems() const { return m_items; }
+
+private:
+	std::vector<Item> m_items;
+	std::vector<Item> m_scratch;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//a linked shader program and a table of its active uniforms, uniform blocks and samplers read when it is linked
+//locations are looked up in the table once and passed to the typed setters, which don't need the program to be bound
+//every sampler is given its own texture unit at link time, in name order, so they are never set while drawing
+class ShaderProgram
+{
+public:
+	//an active uniform, arrays are listed once under their base name
+	typedef struct Uniform
+	{
+		std::string name;
+		int location;
+		unsigned int type;
+		int count;
+		int unit;	//texture unit for samplers, -1 for other uniforms
+	}Uniform;
+
+	typedef struct UniformBlock
+	{
+		std::string name;
+		unsigned int index;
+		int size;	//bytes the buffer bound to the block must hold
+	}UniformBlock;
+
+	ShaderProgram(unsigned int a_handle);
+	~ShaderProgram();
+
+	//read the active uniforms and blocks of the linked program and assign the sampler units, called again after relinking
+	void Reflect();
+
+	unsigned int GetHandle() const { return m_handle; }
+	void Use() const;
+	//location of a uniform, -1 if the program doesn't use it
+	int GetUniformLocation(const char* a_name) const;
+	//texture unit a sampler reads from, -1 if the program doesn't use it
+	int GetSamplerUnit(const char* a_name) const;
+	//index of a uniform block, GL_INVALID_INDEX if the program doesn't use it
+	unsigned int GetUniformBlockIndex(const char* a_name) const;
+	const std::vector<Uniform>& GetUniforms() const { return m_uniforms; }
+	const std::vector<UniformBlock>& GetUniformBlocks() const { return m_uniformBlocks; }
+
+	//typed setters for pre-resolved locations, a location of -1 is ignored like it is by glUniform
+	void SetUniform(int a_location, int a_value) const;
+	void SetUniform(int a_location, float a_value) const;
+	void SetUniform(int a_location, const glm::ivec3& a_value) const;
+	void SetUniform(int a_location, const glm::vec3& a_value) const;
+	void SetUniform(int a_location, const glm::vec4& a_value) const;
+	void SetUniform(int a_location, const glm::mat4& a_value) const;
+
+private:
+	const Uniform* FindUniform(const char* a_name) const;
+
+	unsigned int m_handle;
+	std::vector<Uniform> m_uniforms;
+	std::vector<UniformBlock> m_uniformBlocks;
+};
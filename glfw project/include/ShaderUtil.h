@@ -1,6 +1,10 @@
 #pragma once
+#include <map>
+#include <string>
 #include <vector>
 
+class ShaderProgram;
+
 class ShaderUtil
 {
 public:
@@ -9,8 +13,14 @@ public:
 	static void DestroyInstance();
 	static unsigned int loadShader(const char* a_filename, unsigned int a_type);
 	static void deleteShader(unsigned int a_shaderID);
-	static unsigned int createProgram(const int& a_vertexShader, const int& a_fragmentShader);
-	static void deleteProgram(unsigned int a_program);
+	//link a program and reflect its uniforms, returns nullptr if linking fails
+	static ShaderProgram* createProgram(const int& a_vertexShader, const int& a_fragmentShader);
+	static void deleteProgram(ShaderProgram* a_program);
+	//get the size in bytes of a linked program's binary
+	static size_t getProgramMemoryUsage(unsigned int a_program);
+	//recompile every shader loaded from a file and relink the programs using them in place, program objects
+	//are kept and reflected again so callers don't need to know about the reload. Returns the number of programs relinked
+	static unsigned int reloadShaderFile(const std::string& a_filename);
 
 private:
 	//private Constructor and Destructor
@@ -19,11 +29,15 @@ private:
 	~ShaderUtil();
 
 	std::vector<unsigned int> mShaders;
-	std::vector<unsigned int> mPrograms;
+	std::vector<ShaderProgram*> mPrograms;
+	//normalised source file of each loaded shader, used to find the shaders to reload
+	std::map<unsigned int, std::string> mShaderFiles;
 
 	unsigned int loadShaderInternal(const char* a_filename, unsigned int a_type);
 	void deleteShaderInernal(unsigned int a_shaderID);
-	unsigned int createProgramInternal(const int& a_vertexShader, const int& a_fragmentShader);
-	void deleteProgramInternal(unsigned int a_program);
+	ShaderProgram* createProgramInternal(const int& a_vertexShader, const int& a_fragmentShader);
+	void deleteProgramInternal(ShaderProgram* a_program);
+	unsigned int reloadShaderFileInternal(const std::string& a_filename);
+	bool relinkProgram(ShaderProgram* a_program, unsigned int a_oldShader, unsigned int a_newShader);
 	static ShaderUtil* mInstance;
 };
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include "TextureCompressor.h"
+
 #include <string>
 #include <vector>
 
@@ -12,20 +14,68 @@ public:
 	Texture();
 	~Texture();
 
-	//function to load a texture from file
-	bool Load(std::string a_filename);
-	unsigned int LoadCubeMap(std::vector<std::string> a_filenames, unsigned int* cubemap_face_id);
+	//function to load a texture from file, a_usage picks the format with only the channels it needs and
+	//a_compress uploads it in a BCn format instead
+	bool Load(std::string a_filename, TextureCompressor::Usage a_usage = TextureCompressor::ColourMap, bool a_compress = false);
+	//create the texture with a 1x1 white image so its ID can be used while the image is loaded in the background
+	//the usage and compression are the settings the image is being loaded with, used if the texture is reloaded
+	void CreatePlaceholder(const std::string& a_filename, TextureCompressor::Usage a_usage, bool a_compress);
+	//upload a single level of RGBA8 pixel data without mips
+	void Upload(unsigned int a_width, unsigned int a_height, const void* a_pixels);
+	//upload an image prepared by TextureCompressor level by level, its mip chain has already been built on the CPU
+	//if a pixel unpack buffer is bound a_data is an offset into it. Only the levels in the layout's range become
+	//resident, a layout that ends at the current base level streams those larger levels in below it
+	void Upload(const TextureCompressor::ImageLayout& a_layout, const void* a_data);
+	//release the levels larger than a_baseLevel, they can be streamed back in with Upload
+	void EvictLevels(unsigned int a_baseLevel);
+	//give the levels from a_firstLevel up to the current base level storage and sample from them, their contents are
+	//undefined until they are written, used to copy levels back out of a texture array
+	void AllocateLevels(unsigned int a_firstLevel);
+	//load the faces of a cube map with full mip chains, the faces are prepared in parallel and cached like textures
+	//so later loads upload the cached faces directly. a_compress stores them as BC1, or BC3 if they have transparency
+	unsigned int LoadCubeMap(std::vector<std::string> a_filenames, unsigned int* cubemap_face_id, bool a_compress = true);
+	//reload the image data from the file(s) this texture was loaded from, keeping the same texture ID
+	//so anything that has the ID bound picks up the new data, on failure the old data is left in place
+	bool Reload();
 	void unload();
 	//get filename
 	const std::string& GetFileName() const { return m_filename; }
 	unsigned int GetTextureID() const { return m_textureID; }
 	void GetDimensions(unsigned int& a_w, unsigned int& a_h) const;
+	//get the number of bytes of GPU storage used by this texture, including mip levels
+	size_t GetMemoryUsage() const { return m_memoryUsage; }
+	//the format and levels of the image, its firstLevel is the largest level that is resident
+	const TextureCompressor::ImageLayout& GetLayout() const { return m_layout; }
+	TextureCompressor::Usage GetUsage() const { return m_usage; }
+	bool IsCompressed() const { return m_compressed; }
+
+	//read the whole of an image file into a_data
+	static bool ReadImageFile(const std::string& a_filename, std::vector<unsigned char>& a_data);
+	//decode the contents of an image file to RGBA8 pixels in a_output, which must hold a_width * a_height * 4 bytes and can be
+	//mapped staging memory. Fails if the image isn't the size given. These are safe to call from worker threads
+	//TGA images are decoded by TgaDecoder, other formats by stb_image, a_filename's extension tells them apart
+	static bool DecodeImage(const std::string& a_filename, const std::vector<unsigned char>& a_data, bool a_flipVertically,
+		unsigned int a_width, unsigned int a_height, unsigned char* a_output);
+	static bool GetImageInfo(const std::string& a_filename, int& a_width, int& a_height);
+	//get the face image files if this texture is a cube map, empty otherwise
+	const std::vector<std::string>& GetCubeMapFaces() const { return m_cubeMapFaces; }
 
 private:
 	std::string m_filename;
 	unsigned int m_width;
 	unsigned int m_height;
 	unsigned int m_textureID;
+	size_t m_memoryUsage;
+	//how the texture was loaded, kept so a reload prepares the image the same way
+	TextureCompressor::Usage m_usage;
+	bool m_compressed;
+	//the layout of the uploaded image and the range of levels that are resident
+	TextureCompressor::ImageLayout m_layout;
+
+	void UpdateMemoryUsage();
+	//cube map face files and targets, kept so the cube map can be reloaded
+	std::vector<std::string> m_cubeMapFaces;
+	std::vector<unsigned int> m_cubeMapFaceIDs;
 };
 
 inline void Texture::GetDimensions(unsigned int& a_w, unsigned int& a_h) const
@@ -0,0 +1,51 @@
+#pragma once
+#include "TextureCompressor.h"
+
+#include <vector>
+
+class Texture;
+
+//a GL_TEXTURE_2D_ARRAY that holds textures sharing a size, format and number of levels, one texture per layer
+//textures are copied in on the GPU so any material that uses textures of the same shape can share one binding
+//an array can hold the smaller levels of larger textures, a layer then holds the end of a texture's mip chain
+class TextureArray
+{
+public:
+	TextureArray(const TextureCompressor::ImageLayout& a_layout);
+	~TextureArray();
+
+	//true if a texture with this layout can be stored in the array
+	bool Matches(const TextureCompressor::ImageLayout& a_layout) const;
+	//reserve a free layer, the array grows if it is full. Returns the layer, its contents are undefined until written
+	int AddLayer();
+	//copy a texture into a free layer and return the layer used, the texture must have every level the layer holds resident
+	int AddTexture(const Texture* a_pTexture);
+	//copy the levels a layer of another array holds of the same texture, any larger levels are left for UploadLevels
+	void CopyLayer(int a_layer, const TextureArray& a_source, int a_sourceLayer);
+	//upload the levels of a texture in a_layout's range that this array holds, a_data is laid out like Texture::Upload's
+	//and is an offset into the pixel unpack buffer if one is bound
+	void UploadLevels(int a_layer, const TextureCompressor::ImageLayout& a_layout, const void* a_data);
+	//copy the levels a layer holds that are larger than a texture's resident levels back into the texture
+	void CopyToTexture(int a_layer, Texture* a_pTexture) const;
+	//mark a layer as free for another texture to use
+	void RemoveLayer(int a_layer);
+
+	unsigned int GetTextureID() const { return m_textureID; }
+	unsigned int GetLayerCount() const { return m_layerCount; }
+	//bytes of a single layer including all of its levels
+	size_t GetLayerSize() const { return m_layerSize; }
+	//true if no layers are in use
+	bool IsEmpty() const;
+
+private:
+	//reallocate the array with a_layerCount layers and copy the existing layers across
+	void Resize(unsigned int a_layerCount);
+	//the level of a chain of a_levelCount levels that is this array's first level
+	unsigned int GetFirstLevel(size_t a_levelCount) const { return (unsigned int)(a_levelCount - m_layout.levelSizes.size()); }
+
+	TextureCompressor::ImageLayout m_layout;
+	unsigned int m_textureID;
+	unsigned int m_layerCount;
+	size_t m_layerSize;
+	std::vector<bool> m_usedLayers;
+};
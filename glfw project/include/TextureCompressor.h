@@ -0,0 +1,98 @@
+#pragma once
+#include <string>
+#include <vector>
+
+//builds mip chains on the CPU and compresses RGBA8 images to BCn block formats with stb_dxt, caching the compressed
+//mip chains on disk. Colour maps use BC1 (BC3 if they have any transparency), specular maps BC4 and normal maps BC5
+//uncompressed images only keep the channels their usage needs, R8 for specular maps, RG8 for normal maps and
+//RGB8 for colour maps without transparency. Normal maps stored as two channels have z rebuilt in the shader
+//the compressed chain is written next to the image as <file>.texcache and reused until the image changes
+//mips of colour maps are filtered in linear space from sRGB, normal maps are renormalised after filtering
+class TextureCompressor
+{
+public:
+	//what a texture is used for, this decides the format it is compressed to
+	enum Usage
+	{
+		ColourMap = 0,
+		SpecularMap,
+		NormalMap,
+		CubeMapFace		//a colour map that isn't flipped and doesn't repeat at its edges
+	};
+
+	enum Format
+	{
+		Uncompressed = 0,	//RGBA8
+		BC1,
+		BC3,
+		BC4,
+		BC5,
+		R8,
+		RG8,
+		RGB8
+	};
+
+	//the format and mip levels of an image, the level data is stored one level after another from the largest
+	//levelSizes covers the whole chain while the data only holds the levels from firstLevel up to endLevel
+	typedef struct ImageLayout
+	{
+		Format format;
+		unsigned int width;
+		unsigned int height;
+		std::vector<size_t> levelSizes;
+		unsigned int firstLevel;
+		unsigned int endLevel;
+	}ImageLayout;
+
+	//the contents of the image file an image is prepared from, and a hash of them used to find identical files
+	//data that has already been read is decoded rather than reading the file again
+	typedef struct SourceFile
+	{
+		std::vector<unsigned char> data;
+		unsigned long long hash;
+		bool hashed;
+	}SourceFile;
+
+	//number of bytes needed to hold an image of this size in any format, the output of PrepareImage must be this large
+	static size_t GetMaxImageSize(unsigned int a_width, unsigned int a_height);
+
+	//fill a_output with the image ready to upload, when a_compress is set the cached chain is read if it is up to date,
+	//otherwise the image is decoded, compressed and the cache is written. a_width and a_height are the size of the
+	//image reported by Texture::GetImageInfo. Safe to call from worker threads
+	//a_firstLevel above 0 only returns the smaller levels from a_firstLevel on, the full chain is then cached even when
+	//uncompressed so the larger levels can be streamed in later with ReadCachedLevels. If the cache can't be written
+	//every level is returned, a_layout.firstLevel holds the first level that was
+	//a_pSource is decoded from if it holds the file already, otherwise the file is read into it. Either way it is given
+	//the file's hash, which the cache keeps so images read from the cache have it too
+	static bool PrepareImage(const std::string& a_filename, Usage a_usage, bool a_compress, unsigned int a_width, unsigned int a_height,
+		unsigned int a_firstLevel, ImageLayout& a_layout, unsigned char* a_output, SourceFile* a_pSource = nullptr);
+	//read the levels from a_firstLevel up to a_endLevel out of an image's cache, returns false if it is missing or out of date
+	//a_pSourceHash is set to the hash of the image file the cache was made from
+	static bool ReadCachedLevels(const std::string& a_filename, Usage a_usage, bool a_compress, unsigned int a_width, unsigned int a_height,
+		unsigned int a_firstLevel, unsigned int a_endLevel, ImageLayout& a_layout, unsigned char* a_output, unsigned long long* a_pSourceHash = nullptr);
+	//number of levels in a full mip chain
+	static unsigned int GetLevelCount(unsigned int a_width, unsigned int a_height);
+
+	//the internal format to create the texture with
+	static unsigned int GetGLFormat(Format a_format);
+	//the pixel format of the data of an uncompressed format, passed to glTexImage2D
+	static unsigned int GetGLPixelFormat(Format a_format);
+	//true for the BCn block formats
+	static bool IsCompressedFormat(Format a_format) { return a_format >= BC1 && a_format <= BC5; }
+
+private:
+	static Format ChooseFormat(Usage a_usage, bool a_compress, const unsigned char* a_pixels, unsigned int a_width, unsigned int a_height);
+	static void GetLevelSizes(Format a_format, unsigned int a_width, unsigned int a_height, std::vector<size_t>& a_levelSizes);
+	//build the rest of an RGBA8 mip chain after the image in its first level, each level is filtered from the one
+	//above it by the thread pool in bands of rows
+	static void GenerateMips(unsigned char* a_mips, Usage a_usage, unsigned int a_width, unsigned int a_height);
+	//compress every level of an RGBA8 mip chain into a_output
+	static void Compress(const unsigned char* a_mips, const ImageLayout& a_layout, unsigned char* a_output);
+	//copy the channels an uncompressed format keeps out of every level of an RGBA8 mip chain into a_output
+	//a_output can be the same memory as a_mips
+	static void PackChannels(const unsigned char* a_mips, const ImageLayout& a_layout, unsigned char* a_output);
+	//compress one level, each row of 4x4 blocks is handed to the thread pool
+	static void CompressLevel(const unsigned char* a_pixels, unsigned int a_width, unsigned int a_height, Format a_format, unsigned char* a_output);
+
+	static bool WriteCache(const std::string& a_filename, Usage a_usage, unsigned long long a_sourceHash, const ImageLayout& a_layout, const unsigned char* a_data);
+};
@@ -1,6 +1,15 @@
 #pragma once
+#include "PixelUploadBuffer.h"
+#include "TextureCompressor.h"
+#include "TextureArray.h"
+
+#include <atomic>
+#include <list>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 //forward declare texture as we only need to keep a pointer here
 //and this avoids cyclic dependency
@@ -15,10 +24,63 @@ public:
 	static void DestroyInstance();
 
 	bool TetxureExists(const char* a_pName);
-	unsigned int LoadTexture(const char* a_pfilename);
+	//the owner name is used to attribute the texture memory to a model in the MemoryTracker
+	//a file that is byte for byte the same as a loaded texture with the same usage shares that texture, files are only
+	//hashed when another texture has the same file size
+	//the image is decoded on the worker threads, until it has been uploaded the returned texture ID holds a
+	//1x1 white placeholder so it can be bound straight away. The usage picks the compressed format if compression is on
+	unsigned int LoadTexture(const char* a_pfilename, const char* a_pOwner = nullptr, TextureCompressor::Usage a_usage = TextureCompressor::ColourMap);
 	unsigned int GetTexture(const char* a_filename);
 
 	void ReleaseTexture(unsigned int a_texture);
+	//reload a texture from disk in place if it is loaded, a_filename is compared as a normalised path
+	bool ReloadTexture(const std::string& a_filename);
+	//start queued loads and upload the textures that have finished decoding, call once per frame on the main thread
+	void Update();
+	//number of textures that are still being loaded in the background
+	unsigned int GetPendingLoadCount() const { return (unsigned int)m_pendingLoads.size(); }
+	//compress textures loaded from now on to BCn formats, using the on-disk texture cache
+	void SetCompressionEnabled(bool a_enabled) { m_compressionEnabled = a_enabled; }
+	bool IsCompressionEnabled() const { return m_compressionEnabled; }
+
+	//mip streaming loads textures with only their small levels resident, larger levels are read from the texture cache
+	//as they are requested and released again once they haven't been needed for a while
+	void SetStreamingEnabled(bool a_enabled) { m_streamingEnabled = a_enabled; }
+	bool IsStreamingEnabled() const { return m_streamingEnabled; }
+	//number of bytes of levels that can be streamed in per frame, one load always starts even if it is larger
+	void SetStreamingBudget(size_t a_bytesPerFrame) { m_streamingBudget = a_bytesPerFrame; }
+	size_t GetStreamingBudget() const { return m_streamingBudget; }
+	//ask for a texture to have the level resident that is sampled when one pixel covers a_uvPerPixel of its texture
+	//coordinates, call every frame for every texture that is drawn. Textures that aren't requested drop back to their small levels
+	void RequestTextureDetail(unsigned int a_texture, float a_uvPerPixel);
+
+	//textures that finish loading are also copied into a texture array shared with every texture of the same size and
+	//format, so materials can be drawn without rebinding individual textures. A layer holds the levels the texture has
+	//resident, when streaming changes them the texture moves to the array for its new largest level. A packed texture
+	//only keeps its always resident small levels itself, the rest are copied back from its layer if arrays are turned off
+	void SetTextureArraysEnabled(bool a_enabled) { m_textureArraysEnabled = a_enabled; }
+	bool IsTextureArraysEnabled() const { return m_textureArraysEnabled; }
+	//find the texture array and layer a texture has been copied into, returns false if it isn't in an array
+	bool GetTextureLayer(unsigned int a_texture, unsigned int& a_arrayTexture, int& a_layer);
+
+	//textures that are no longer referenced stay loaded in a least recently used cache so loading them again is free,
+	//the oldest are deleted while the textures use more memory than the budget. A budget of 0 never evicts
+	void SetMemoryBudget(size_t a_bytes) { m_memoryBudget = a_bytes; }
+	size_t GetMemoryBudget() const { return m_memoryBudget; }
+
+	//memory use and cache statistics, hits are loads of a texture that was already loaded
+	typedef struct TextureStats
+	{
+		size_t memoryUsage;
+		size_t memoryBudget;
+		unsigned int textureCount;
+		unsigned int cachedCount;	//unreferenced textures waiting in the cache
+		unsigned int hits;
+		unsigned int misses;
+		unsigned int evictions;
+		unsigned int sharedFiles;	//files loaded that were identical to a texture that was already loaded
+	}TextureStats;
+	TextureStats GetStats() const;
 
 private:
 	static TextureManager* m_instance;
@@ -30,9 +92,125 @@ private:
 	{
 		Texture* pTexture;
 		unsigned int refCount;
+		std::string owner;
+		//mip streaming state, the smallest level number requested since the last update and how many
+		//updates the resident levels have been larger than needed
+		unsigned int requestedLevel;
+		unsigned int framesUnused;
+		bool loading;		//a load for this texture is in progress
+		bool streamable;	//the texture's levels can be read back from its cache
+		//the texture array holding a copy of the texture, -1 if it isn't in one
+		int arrayIndex;
+		int arrayLayer;
+		//the level of the texture that is the first level of its array layer, the largest level it is drawn with
+		unsigned int arrayLevel;
+		//bytes charged to the owner for the texture and its array layer
+		size_t memoryUsage;
+		//position in the cache of unreferenced textures, only valid while refCount is 0
+		std::list<std::string>::iterator cacheEntry;
+		//the size and hash of the image file, the hash is only worked out once another file has the same size
+		unsigned long long fileSize;
+		unsigned long long contentHash;
+		bool hashed;
+		//other files with the same contents that share this texture
+		std::vector<std::string> aliases;
 	}TextureRef;
 
-	std::map<std::string, TextureRef> m_pTextureMap;
+	typedef std::map<std::string, TextureRef> TextureMap;
+	TextureMap m_pTextureMap;
+	//index from texture ID to its entry in the map, map iterators stay valid until the entry is erased
+	std::unordered_map<unsigned int, TextureMap::iterator> m_textureIDs;
+	//unreferenced textures, least recently used first
+	std::list<std::string> m_textureCache;
+	//textures by the size of their file, to find the candidates a new file could be identical to
+	std::unordered_multimap<unsigned long long, TextureMap::iterator> m_fileSizes;
+	//files that share the texture of an identical file, mapped to the name that texture is stored under
+	std::unordered_map<std::string, std::string> m_pathAliases;
+	unsigned int m_sharedFiles;
+	size_t m_memoryBudget;
+	size_t m_memoryUsage;
+	unsigned int m_cacheHits;
+	unsigned int m_cacheMisses;
+	unsigned int m_evictions;
+
+	//state of a texture that is being loaded in the background
+	enum LoadState
+	{
+		Queued = 0,	//waiting for space in the upload buffer
+		Decoding,	//submitted to the thread pool
+		Decoded,	//image is ready to upload
+		Failed
+	};
+
+	//a background texture load, shared between the main thread and the worker decoding it
+	typedef struct PendingLoad
+	{
+		std::string filename;
+		Texture* pTexture;	//null if the texture was released before the load finished
+		TextureCompressor::Usage usage;
+		bool compress;
+		int width;
+		int height;
+		//the range of levels to load, a streaming load reads its levels from the texture cache
+		unsigned int firstLevel;
+		unsigned int endLevel;
+		bool stream;
+		size_t bytes;
+		//staging memory in the upload buffer, or memory on the heap for images too large for it
+		size_t stagingOffset;
+		void* pStaging;
+		std::vector<unsigned char> pixels;
+		//the image file, holding its contents if they were read to compare with other files so they are only read once
+		//the worker hashes the file as it decodes it and frees the contents
+		TextureCompressor::SourceFile source;
+		//written by the worker before the state is set to Decoded
+		TextureCompressor::ImageLayout layout;
+		std::atomic<int> state;
+	}PendingLoad;
+
+	std::vector<std::shared_ptr<PendingLoad>> m_pendingLoads;
+	PixelUploadBuffer m_uploadBuffer;
+	bool m_compressionEnabled;
+	bool m_streamingEnabled;
+	size_t m_streamingBudget;
+	bool m_textureArraysEnabled;
+	std::vector<TextureArray*> m_textureArrays;
+
+	//reserve staging memory for a queued load and hand it to the thread pool, returns false if there isn't space yet
+	bool StartLoad(std::shared_ptr<PendingLoad> a_load);
+	void FinishLoad(PendingLoad& a_load);
+	//stream levels in or out of every texture to match the requests made since the last update
+	void UpdateStreaming();
+	//copy the resident levels of a texture into a texture array with space for them
+	void PackTexture(TextureRef& a_texRef);
+	//move a packed texture to the array that holds its levels from a_level on, the levels its layer already has are
+	//copied across and any larger ones are uploaded from a_pLevels, which may be null when the texture is getting smaller
+	void RepackTexture(TextureRef& a_texRef, unsigned int a_level, const TextureCompressor::ImageLayout* a_pLevels, const void* a_data);
+	//take a texture out of its array, a_restoreLevels copies the levels only the layer has back into the texture
+	void UnpackTexture(TextureRef& a_texRef, bool a_restoreLevels);
+	//find the array textures with this layout are packed into, creating it if there isn't one
+	int FindTextureArray(const TextureCompressor::ImageLayout& a_layout);
+	//free a layer of an array, deleting the array once it is empty
+	void ReleaseArrayLayer(int a_arrayIndex, int a_layer);
+	//charge the owner for the memory the texture now uses
+	void TrackMemoryUsage(TextureRef& a_texRef);
+	//take another reference to a texture, removing it from the cache if it was unreferenced
+	unsigned int AddReference(TextureRef& a_texRef);
+	//delete unreferenced textures, oldest first, until the memory used is within the budget
+	void EvictTextures();
+	void DeleteTexture(TextureMap::iterator a_iter);
+	//find a texture by the name it was stored under or by a file that shares it
+	TextureMap::iterator FindTexture(const std::string& a_filename);
+	//find a loaded texture with the same usage and compression whose file has the same contents as a_filename
+	//a_source is given the contents and hash of a_filename if they had to be read, so loading the file doesn't read it again
+	TextureMap::iterator FindIdenticalTexture(const std::string& a_filename, TextureCompressor::Usage a_usage,
+		unsigned long long a_fileSize, TextureCompressor::SourceFile& a_source);
+	//move a texture to a new file size in the index of file sizes, a_known is false to take it out of the index
+	void SetFileSize(TextureMap::iterator a_iter, unsigned long long a_fileSize, bool a_known);
+	//stop a file sharing a texture, later loads of it create their own texture
+	void RemoveAlias(TextureRef& a_texRef, const std::string& a_alias);
+	TextureRef* FindTextureRef(const Texture* a_pTexture);
+	TextureRef* FindTextureRef(unsigned int a_texture);
 
 	TextureManager();
 	~TextureManager();
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+
+//decodes the TGA images used by model textures straight to RGBA8 in the caller's memory, which can be mapped
+//staging memory. Handles uncompressed and RLE true colour (24 and 32 bit) and greyscale (8 bit) images, the
+//image is written in the row order that is asked for so flipping it costs nothing. Anything else is left to stb_image
+class TgaDecoder
+{
+public:
+	//read the size of an image from its header, returns false if it isn't a TGA image this decoder handles
+	static bool GetInfo(const unsigned char* a_data, size_t a_size, unsigned int& a_width, unsigned int& a_height);
+	//decode an image to RGBA8, a_output must hold width * height * 4 bytes. When a_flipVertically is set the bottom
+	//row of the image is written first, matching stb_image with stbi_set_flip_vertically_on_load
+	static bool Decode(const unsigned char* a_data, size_t a_size, bool a_flipVertically, unsigned char* a_output);
+
+private:
+	//convert a run of pixels from the file's pixel format to RGBA8
+	static void ConvertPixels(const unsigned char* a_source, unsigned int a_pixelSize, unsigned int a_count, unsigned char* a_output);
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//a pool of worker threads that run jobs in the order they are submitted
+//jobs must not make GL calls, any GL work has to be handed back to the main thread
+class ThreadPool
+{
+public:
+	//this class will act as a singleton object for ease of access
+	static ThreadPool* CreateInstance();
+	static ThreadPool* GetInstance();
+	static void DestroyInstance();
+
+	//queue a job to be run on one of the worker threads
+	void Submit(std::function<void()> a_job);
+	//run a_function for every index from 0 to a_count - 1 spread across the workers and the calling thread, returns once
+	//all of them have finished. The calling thread takes part so this is safe to call from inside a job
+	void ParallelFor(unsigned int a_count, const std::function<void(unsigned int)>& a_function);
+	unsigned int GetWorkerCount() const { return (unsigned int)m_workers.size(); }
+
+private:
+	static ThreadPool* m_instance;
+
+	ThreadPool();
+	~ThreadPool();
+
+	void WorkerThread();
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	bool m_running;
+};
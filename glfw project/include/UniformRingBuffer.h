@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//a persistently mapped uniform buffer split into one region per frame in flight, used for uniform blocks and
+//per instance vertex data that are rewritten every frame. Each frame's data is written into the next region, which is only reused once
+//a fence shows the GPU has finished the frame that last read it. Allocations are aligned so each one can be
+//bound to a uniform or shader storage block with glBindBufferRange
+class UniformRingBuffer
+{
+public:
+	UniformRingBuffer();
+	~UniformRingBuffer();
+
+	bool Create(size_t a_frameCapacity, unsigned int a_frameCount = 3);
+	void Destroy();
+
+	unsigned int GetBufferID() const { return m_bufferID; }
+	size_t GetFrameCapacity() const { return m_frameCapacity; }
+	//size of an allocation of a_bytes once it is padded to the uniform buffer offset alignment
+	size_t GetAlignedSize(size_t a_bytes) const;
+
+	//start writing the next frame's region, a_bytes is the aligned total the frame will allocate. The buffer is
+	//recreated larger if that won't fit, waits if the GPU is still reading the region from an earlier frame
+	void BeginFrame(size_t a_bytes);
+	//reserve a_bytes in the current frame's region, returns null if the region is full
+	void* Allocate(size_t a_bytes, size_t& a_offset);
+	//call once every command reading the current frame's region has been issued
+	void EndFrame();
+
+private:
+	unsigned int m_bufferID;
+	unsigned char* m_pData;
+	size_t m_frameCapacity;
+	size_t m_alignment;
+	unsigned int m_frame;
+	size_t m_head;
+	//GLsync of the last frame to use each region, null if the region is free
+	std::vector<void*> m_fences;
+};
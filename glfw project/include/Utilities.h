@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <string>
 
 //a utility class with static helper methods
 class Utility
@@ -14,6 +15,12 @@ public:
 
 	//helper functions for loading shader code into memory
 	static char* fileToBuffer(const char* a_sPath);
+	//convert a path to an absolute, normalised form so different spellings of the same file compare equal
+	static std::string normalisePath(const std::string& a_path);
+	//64 bit hash of a block of memory, it runs over 32 bytes at a time so whole files can be hashed quickly
+	static unsigned long long hashBytes(const void* a_data, size_t a_size, unsigned long long a_seed = 0);
+	//hash the contents of a file, returns false if it can't be read
+	static bool hashFile(const std::string& a_path, unsigned long long& a_hash);
 
 	//utility for mouse / keyboard movement of a matrix transform (suitable for camera)
 	static void freeMovement(glm::mat4& a_transform, float a_deltaTime, float a_speed, const glm::vec3& a_up = glm::vec3(0, 1, 0));
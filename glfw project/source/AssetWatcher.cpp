@@ -0,0 +1,309 @@
+#include "AssetWatcher.h"
+#include "ApplicationEvent.h"
+#include "Dispatcher.h"
+#include "Utilities.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+//how long the watch thread sleeps between checks for changes
+static const int s_pollIntervalMs = 250;
+//files the application writes next to its assets, changes to them are never reported
+static const char* const s_ignoredExtensions[] = { ".texcache", ".geocache" };
+
+static bool isIgnoredFile(const std::string& a_path)
+{
+	for (const char* extension : s_ignoredExtensions)
+	{
+		size_t length = strlen(extension);
+		if (a_path.size() >= length && a_path.compare(a_path.size() - length, length, extension) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//set up static pointer for singleton object
+AssetWatcher* AssetWatcher::m_instance = nullptr;
+
+AssetWatcher* AssetWatcher::CreateInstance()
+{
+	if (m_instance == nullptr)
+	{
+		m_instance = new AssetWatcher();
+	}
+	return m_instance;
+}
+
+AssetWatcher* AssetWatcher::GetInstance()
+{
+	if (m_instance == nullptr)
+	{
+		return AssetWatcher::CreateInstance();
+	}
+	return m_instance;
+}
+
+void AssetWatcher::DestroyInstance()
+{
+	if (m_instance != nullptr)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+AssetWatcher::AssetWatcher() : m_running(true), m_watchListDirty(false)
+{
+#ifdef __linux__
+	m_inotifyHandle = inotify_init1(IN_NONBLOCK);
+	if (m_inotifyHandle < 0)
+	{
+		std::cout << "Unable to initialise inotify, hot reloading is disabled" << std::endl;
+	}
+#endif
+	m_thread = std::thread(&AssetWatcher::WatchThread, this);
+}
+
+AssetWatcher::~AssetWatcher()
+{
+	//stop the watch thread and wait for it to finish before cleaning up
+	m_running = false;
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+#ifdef __linux__
+	if (m_inotifyHandle >= 0)
+	{
+		close(m_inotifyHandle);
+	}
+#endif
+}
+
+void AssetWatcher::WatchDirectory(const std::string& a_directory, bool a_recursive)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_directories.push_back(std::make_pair(Utility::normalisePath(a_directory), a_recursive));
+	m_watchListDirty = true;
+}
+
+void AssetWatcher::WatchFile(const std::string& a_filename)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_files.insert(Utility::normalisePath(a_filename)).second)
+	{
+		m_watchListDirty = true;
+	}
+}
+
+void AssetWatcher::Update()
+{
+	//take the changes out of the queue first so handlers can't deadlock by adding new watches
+	std::set<std::string> changed;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		changed.swap(m_changed);
+	}
+
+	Dispatcher* dp = Dispatcher::GetInstance();
+	for (auto iter = changed.begin(); iter != changed.end(); ++iter)
+	{
+		std::cout << "Asset changed: " << *iter << std::endl;
+		if (dp != nullptr)
+		{
+			AssetChangedEvent e(*iter);
+			dp->Publish(&e);
+		}
+	}
+}
+
+void AssetWatcher::QueueChange(const std::string& a_path)
+{
+	if (isIgnoredFile(a_path)) { return; }
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_changed.insert(a_path);
+}
+
+#ifdef __linux__
+
+void AssetWatcher::WatchThread()
+{
+	if (m_inotifyHandle < 0) { return; }
+
+	//directories that are watched for the sake of individual files only report those files
+	std::set<std::string> wholeDirectories;
+	//directories whose new sub directories are watched as they are created
+	std::set<std::string> recursiveDirectories;
+	std::set<std::string> files;
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	//directories are watched for new sub directories as well as written files
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+	//watch a directory, and if recursive every directory below it, as inotify watches are not recursive.
+	//When a_reportFiles is set the files already in them are reported, a new directory can have been
+	//written to before its watch was added
+	auto watchDirectory = [&](const std::string& a_directory, bool a_recursive, bool a_reportFiles)
+	{
+		std::vector<std::string> directories = { a_directory };
+		std::error_code error;
+		if (a_recursive)
+		{
+			for (auto& entry : std::filesystem::recursive_directory_iterator(a_directory, error))
+			{
+				if (entry.is_directory(error))
+				{
+					directories.push_back(entry.path().lexically_normal().generic_string());
+				}
+				else if (a_reportFiles && entry.is_regular_file(error))
+				{
+					QueueChange(entry.path().lexically_normal().generic_string());
+				}
+			}
+		}
+		for (auto& directory : directories)
+		{
+			int wd = inotify_add_watch(m_inotifyHandle, directory.c_str(), mask);
+			if (wd >= 0)
+			{
+				m_watchDescriptors[wd] = directory;
+				wholeDirectories.insert(directory);
+				if (a_recursive) { recursiveDirectories.insert(directory); }
+			}
+		}
+	};
+
+	while (m_running)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_watchListDirty)
+			{
+				for (auto iter = m_directories.begin(); iter != m_directories.end(); ++iter)
+				{
+					watchDirectory(iter->first, iter->second, false);
+				}
+				for (auto iter = m_files.begin(); iter != m_files.end(); ++iter)
+				{
+					std::string directory = std::filesystem::path(*iter).parent_path().generic_string();
+					int wd = inotify_add_watch(m_inotifyHandle, directory.c_str(), mask);
+					if (wd >= 0)
+					{
+						m_watchDescriptors[wd] = directory;
+					}
+				}
+				files = m_files;
+				m_watchListDirty = false;
+			}
+		}
+
+		//wait for events with a timeout so the running flag and watch list are checked regularly
+		pollfd pfd = { m_inotifyHandle, POLLIN, 0 };
+		if (poll(&pfd, 1, s_pollIntervalMs) <= 0) { continue; }
+
+		ssize_t length = read(m_inotifyHandle, buffer, sizeof(buffer));
+		for (char* ptr = buffer; length > 0 && ptr < buffer + length; )
+		{
+			const inotify_event* event = (const inotify_event*)ptr;
+			ptr += sizeof(inotify_event) + event->len;
+			if (event->len == 0) { continue; }
+
+			auto wdIter = m_watchDescriptors.find(event->wd);
+			if (wdIter == m_watchDescriptors.end()) { continue; }
+
+			std::string path = wdIter->second + "/" + event->name;
+			if (event->mask & IN_ISDIR)
+			{
+				//a directory created or moved into a recursively watched one is watched along with everything in it
+				if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && recursiveDirectories.count(wdIter->second) > 0)
+				{
+					watchDirectory(path, true, true);
+				}
+				continue;
+			}
+			//new files are reported once they have been written and closed
+			if (event->mask & IN_CREATE) { continue; }
+			if (wholeDirectories.count(wdIter->second) > 0 || files.count(path) > 0)
+			{
+				QueueChange(path);
+			}
+		}
+	}
+}
+
+#else
+
+void AssetWatcher::WatchThread()
+{
+	//last known write time of every watched file
+	std::map<std::string, std::filesystem::file_time_type> writeTimes;
+	bool firstScan = true;
+
+	while (m_running)
+	{
+		std::vector<std::pair<std::string, bool>> directories;
+		std::set<std::string> files;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			directories = m_directories;
+			files = m_files;
+			if (m_watchListDirty)
+			{
+				//newly watched files are recorded without being reported as changed
+				firstScan = true;
+				m_watchListDirty = false;
+			}
+		}
+
+		std::error_code error;
+		for (auto iter = directories.begin(); iter != directories.end(); ++iter)
+		{
+			if (iter->second)
+			{
+				for (auto& entry : std::filesystem::recursive_directory_iterator(iter->first, error))
+				{
+					if (entry.is_regular_file(error)) { files.insert(entry.path().lexically_normal().generic_string()); }
+				}
+			}
+			else
+			{
+				for (auto& entry : std::filesystem::directory_iterator(iter->first, error))
+				{
+					if (entry.is_regular_file(error)) { files.insert(entry.path().lexically_normal().generic_string()); }
+				}
+			}
+		}
+
+		for (auto iter = files.begin(); iter != files.end(); ++iter)
+		{
+			std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(*iter, error);
+			if (error) { continue; }
+
+			auto timeIter = writeTimes.find(*iter);
+			if (timeIter == writeTimes.end())
+			{
+				writeTimes[*iter] = writeTime;
+				if (!firstScan) { QueueChange(*iter); }
+			}
+			else if (timeIter->second != writeTime)
+			{
+				timeIter->second = writeTime;
+				QueueChange(*iter);
+			}
+		}
+		firstScan = false;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(s_pollIntervalMs));
+	}
+}
+
+#endif
@@ -0,0 +1,140 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE2
+#endif
+
+FrustumCuller::FrustumCuller() : m_centreX(), m_centreY(), m_centreZ(), m_extentX(), m_extentY(), m_extentZ(), m_visible(), m_count(0)
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		m_planes[i] = glm::vec4(0.0f);
+	}
+}
+
+void FrustumCuller::SetFrustum(const glm::mat4& a_projectionView)
+{
+	//each plane is the last row of the matrix plus or minus one of the others, glm matrices are stored by column
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		rows[i] = glm::vec4(a_projectionView[0][i], a_projectionView[1][i], a_projectionView[2][i], a_projectionView[3][i]);
+	}
+	m_planes[0] = rows[3] + rows[0];	//left
+	m_planes[1] = rows[3] - rows[0];	//right
+	m_planes[2] = rows[3] + rows[1];	//bottom
+	m_planes[3] = rows[3] - rows[1];	//top
+	m_planes[4] = rows[3] + rows[2];	//near
+	m_planes[5] = rows[3] - rows[2];	//far
+	for (int i = 0; i < 6; ++i)
+	{
+		float length = glm::length(glm::vec3(m_planes[i]));
+		if (length > 0.0f)
+		{
+			m_planes[i] /= length;
+		}
+	}
+}
+
+void FrustumCuller::Clear()
+{
+	m_centreX.clear();
+	m_centreY.clear();
+	m_centreZ.clear();
+	m_extentX.clear();
+	m_extentY.clear();
+	m_extentZ.clear();
+	m_count = 0;
+}
+
+unsigned int FrustumCuller::AddBounds(const glm::vec3& a_centre, const glm::vec3& a_extents, const glm::mat4& a_transform)
+{
+	//the centre is transformed as a point, each world axis of the box reaches as far as the transformed model
+	//axes do along it, which is the absolute values of the rotation and scale part of the matrix times the extents
+	glm::vec3 centre = glm::vec3(a_transform * glm::vec4(a_centre, 1.0f));
+	glm::vec3 extents = glm::abs(glm::vec3(a_transform[0])) * a_extents.x + glm::abs(glm::vec3(a_transform[1])) * a_extents.y +
+		glm::abs(glm::vec3(a_transform[2])) * a_extents.z;
+	m_centreX.push_back(centre.x);
+	m_centreY.push_back(centre.y);
+	m_centreZ.push_back(centre.z);
+	m_extentX.push_back(extents.x);
+	m_extentY.push_back(extents.y);
+	m_extentZ.push_back(extents.z);
+	return m_count++;
+}
+
+void FrustumCuller::GetBounds(unsigned int a_index, glm::vec3& a_centre, glm::vec3& a_extents) const
+{
+	a_centre = glm::vec3(m_centreX[a_index], m_centreY[a_index], m_centreZ[a_index]);
+	a_extents = glm::vec3(m_extentX[a_index], m_extentY[a_index], m_extentZ[a_index]);
+}
+
+unsigned int FrustumCuller::Cull()
+{
+	//pad to whole groups of four so the loop below doesn't need a remainder, the padding boxes are never read back
+	size_t padded = (m_count + 3) & ~(size_t)3;
+	m_centreX.resize(padded, 0.0f);
+	m_centreY.resize(padded, 0.0f);
+	m_centreZ.resize(padded, 0.0f);
+	m_extentX.resize(padded, 0.0f);
+	m_extentY.resize(padded, 0.0f);
+	m_extentZ.resize(padded, 0.0f);
+	m_visible.resize(padded);
+
+	//a box is outside a plane when its centre is further behind the plane than the box reaches towards it
+	unsigned int visibleCount = 0;
+	size_t i = 0;
+#ifdef FRUSTUM_CULLER_SSE2
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm_set1_ps(m_planes[p].x);
+		planeY[p] = _mm_set1_ps(m_planes[p].y);
+		planeZ[p] = _mm_set1_ps(m_planes[p].z);
+		planeW[p] = _mm_set1_ps(m_planes[p].w);
+		absX[p] = _mm_set1_ps(fabsf(m_planes[p].x));
+		absY[p] = _mm_set1_ps(fabsf(m_planes[p].y));
+		absZ[p] = _mm_set1_ps(fabsf(m_planes[p].z));
+	}
+	const __m128 zero = _mm_setzero_ps();
+	for (; i < padded; i += 4)
+	{
+		__m128 centreX = _mm_loadu_ps(&m_centreX[i]), centreY = _mm_loadu_ps(&m_centreY[i]), centreZ = _mm_loadu_ps(&m_centreZ[i]);
+		__m128 extentX = _mm_loadu_ps(&m_extentX[i]), extentY = _mm_loadu_ps(&m_extentY[i]), extentZ = _mm_loadu_ps(&m_extentZ[i]);
+		__m128 outside = zero;
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centreX), _mm_mul_ps(planeY[p], centreY)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], centreZ), planeW[p]));
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), zero));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			m_visible[i + lane] = (mask & (1 << lane)) ? 0 : 1;
+		}
+	}
+#endif
+	for (; i < padded; ++i)
+	{
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p)
+		{
+			const glm::vec4& plane = m_planes[p];
+			float distance = plane.x * m_centreX[i] + plane.y * m_centreY[i] + plane.z * m_centreZ[i] + plane.w;
+			float reach = fabsf(plane.x) * m_extentX[i] + fabsf(plane.y) * m_extentY[i] + fabsf(plane.z) * m_extentZ[i];
+			outside = (distance + reach < 0.0f);
+		}
+		m_visible[i] = outside ? 0 : 1;
+	}
+
+	for (unsigned int n = 0; n < m_count; ++n)
+	{
+		visibleCount += m_visible[n];
+	}
+	return visibleCount;
+}
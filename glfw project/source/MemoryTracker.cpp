@@ -0,0 +1,151 @@
+#include "MemoryTracker.h"
+
+#include <cstdio>
+
+//set up static pointer for singleton object
+MemoryTracker* MemoryTracker::m_instance = nullptr;
+
+MemoryTracker* MemoryTracker::CreateInstance()
+{
+	if (m_instance == nullptr)
+	{
+		m_instance = new MemoryTracker();
+	}
+	return m_instance;
+}
+
+MemoryTracker* MemoryTracker::GetInstance()
+{
+	if (m_instance == nullptr)
+	{
+		return MemoryTracker::CreateInstance();
+	}
+	return m_instance;
+}
+
+void MemoryTracker::DestroyInstance()
+{
+	if (m_instance != nullptr)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+MemoryTracker::MemoryTracker() : m_categoryTotals(), m_owners()
+{
+
+}
+
+MemoryTracker::~MemoryTracker()
+{
+	m_owners.clear();
+}
+
+void MemoryTracker::Allocate(Category a_category, const std::string& a_owner, size_t a_bytes)
+{
+	//resources may outlive the tracker during shutdown, so don't create a new instance here
+	if (m_instance == nullptr || a_bytes == 0) { return; }
+
+	//operator[] value initialises a new record so all of its counters start at zero
+	OwnerRecord& record = m_instance->m_owners[a_owner];
+	record.bytes[a_category] += a_bytes;
+	m_instance->m_categoryTotals[a_category] += a_bytes;
+}
+
+void MemoryTracker::Free(Category a_category, const std::string& a_owner, size_t a_bytes)
+{
+	if (m_instance == nullptr || a_bytes == 0) { return; }
+
+	auto ownerIter = m_instance->m_owners.find(a_owner);
+	if (ownerIter == m_instance->m_owners.end()) { return; }
+
+	//clamp so a mismatched free can't wrap the counters around
+	OwnerRecord& record = ownerIter->second;
+	size_t bytes = (a_bytes < record.bytes[a_category]) ? a_bytes : record.bytes[a_category];
+	record.bytes[a_category] -= bytes;
+	m_instance->m_categoryTotals[a_category] -= bytes;
+
+	//remove the owner once it no longer holds any memory
+	size_t remaining = 0;
+	for (int i = 0; i < Category_Count; ++i)
+	{
+		remaining += record.bytes[i];
+	}
+	if (remaining == 0)
+	{
+		m_instance->m_owners.erase(ownerIter);
+	}
+}
+
+size_t MemoryTracker::GetOwnerTotal(const std::string& a_owner) const
+{
+	size_t total = 0;
+	auto ownerIter = m_owners.find(a_owner);
+	if (ownerIter != m_owners.end())
+	{
+		for (int i = 0; i < Category_Count; ++i)
+		{
+			total += ownerIter->second.bytes[i];
+		}
+	}
+	return total;
+}
+
+size_t MemoryTracker::GetOwnerCategoryTotal(const std::string& a_owner, Category a_category) const
+{
+	auto ownerIter = m_owners.find(a_owner);
+	return (ownerIter != m_owners.end()) ? ownerIter->second.bytes[a_category] : 0;
+}
+
+size_t MemoryTracker::GetCPUTotal() const
+{
+	size_t total = 0;
+	for (int i = 0; i < Category_Count; ++i)
+	{
+		if (!IsGPUCategory((Category)i))
+		{
+			total += m_categoryTotals[i];
+		}
+	}
+	return total;
+}
+
+size_t MemoryTracker::GetGPUTotal() const
+{
+	size_t total = 0;
+	for (int i = 0; i < Category_Count; ++i)
+	{
+		if (IsGPUCategory((Category)i))
+		{
+			total += m_categoryTotals[i];
+		}
+	}
+	return total;
+}
+
+const char* MemoryTracker::GetCategoryName(Category a_category)
+{
+	switch (a_category)
+	{
+	case MeshData: return "Mesh Data";
+	case MaterialData: return "Materials";
+	case TextureData: return "Textures";
+	case ShaderData: return "Shader Programs";
+	case BufferData: return "Vertex/Index Buffers";
+	default: return "Unknown";
+	}
+}
+
+std::string MemoryTracker::FormatBytes(size_t a_bytes)
+{
+	//display size in KB if under 1 MB, in MB if under 1 GB or in GB if over 1 GB
+	char buffer[32];
+	if (a_bytes / 1024.0f < 1024.0f)
+		snprintf(buffer, sizeof(buffer), "%0.1f KB", a_bytes / 1024.0f);
+	else if (a_bytes / (1024.0f * 1024.0f) < 1024.0f)
+		snprintf(buffer, sizeof(buffer), "%0.2f MB", a_bytes / (1024.0f * 1024.0f));
+	else
+		snprintf(buffer, sizeof(buffer), "%0.2f GB", a_bytes / (1024.0f * 1024.0f * 1024.0f));
+	return buffer;
+}
@@ -0,0 +1,200 @@
+#include "MeshPool.h"
+#include "MemoryTracker.h"
+#include "obj_Loader.h"
+
+#include <algorithm>
+#include <glad/glad.h>
+
+//size each buffer starts at, they double when they run out of space
+static const size_t s_initialBufferBytes = 16 * 1024 * 1024;
+
+MeshPool::MeshPool(unsigned int a_instanceLocation, unsigned int a_instanceBinding) : m_instanceLocation(a_instanceLocation), m_instanceBinding(a_instanceBinding),
+	m_vertices(), m_indices(), m_vertexArrays(), m_meshes()
+{
+	m_vertices = { 0, sizeof(OBJVertex), 0, std::map<size_t, size_t>() };
+	m_indices[0] = { 0, sizeof(unsigned int), 0, std::map<size_t, size_t>() };
+	m_indices[1] = { 0, sizeof(unsigned short), 0, std::map<size_t, size_t>() };
+}
+
+MeshPool::~MeshPool()
+{
+	Clear();
+}
+
+bool MeshPool::AddMesh(OBJMesh* a_pMesh)
+{
+	size_t vertexCount = a_pMesh->getVertexCount(), indexCount = a_pMesh->getIndexCount();
+	if (a_pMesh->m_inMeshPool || a_pMesh->m_vertexBufferID == 0 || vertexCount == 0 || indexCount == 0) { return false; }
+	//16 bit indices stay 16 bit, a base vertex is added to them when they are drawn
+	PoolBuffer& indices = m_indices[a_pMesh->usesShortIndices() ? 1 : 0];
+
+	size_t baseVertex = 0, firstIndex = 0;
+	if (!Allocate(m_vertices, vertexCount, baseVertex))
+	{
+		Grow(m_vertices, m_vertices.capacity + vertexCount);
+		Allocate(m_vertices, vertexCount, baseVertex);
+	}
+	if (!Allocate(indices, indexCount, firstIndex))
+	{
+		Grow(indices, indices.capacity + indexCount);
+		Allocate(indices, indexCount, firstIndex);
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, a_pMesh->m_vertexBufferID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertices.bufferID);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, baseVertex * m_vertices.elementSize, vertexCount * m_vertices.elementSize);
+	glBindBuffer(GL_COPY_READ_BUFFER, a_pMesh->m_indexBufferID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indices.bufferID);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, firstIndex * indices.elementSize, indexCount * indices.elementSize);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	a_pMesh->m_poolBaseVertex = (unsigned int)baseVertex;
+	a_pMesh->m_poolFirstIndex = (unsigned int)firstIndex;
+	a_pMesh->m_inMeshPool = true;
+	m_meshes.push_back(a_pMesh);
+	return true;
+}
+
+void MeshPool::RemoveMesh(OBJMesh* a_pMesh)
+{
+	auto iter = std::find(m_meshes.begin(), m_meshes.end(), a_pMesh);
+	if (iter == m_meshes.end()) { return; }
+	Free(m_vertices, a_pMesh->m_poolBaseVertex, a_pMesh->getVertexCount());
+	Free(m_indices[a_pMesh->usesShortIndices() ? 1 : 0], a_pMesh->m_poolFirstIndex, a_pMesh->getIndexCount());
+	a_pMesh->m_inMeshPool = false;
+	m_meshes.erase(iter);
+}
+
+void MeshPool::Clear()
+{
+	for (auto iter = m_meshes.begin(); iter != m_meshes.end(); ++iter)
+	{
+		(*iter)->m_inMeshPool = false;
+	}
+	m_meshes.clear();
+	Release(m_vertices);
+	Release(m_indices[0]);
+	Release(m_indices[1]);
+	glDeleteVertexArrays(2, m_vertexArrays);
+	m_vertexArrays[0] = m_vertexArrays[1] = 0;
+}
+
+size_t MeshPool::GetMemoryUsage() const
+{
+	return m_vertices.capacity * m_vertices.elementSize + m_indices[0].capacity * m_indices[0].elementSize + m_indices[1].capacity * m_indices[1].elementSize;
+}
+
+bool MeshPool::Allocate(PoolBuffer& a_buffer, size_t a_count, size_t& a_offset)
+{
+	//first fit, meshes are mostly added and removed a model at a time so this keeps fragmentation low enough
+	for (auto iter = a_buffer.freeRanges.begin(); iter != a_buffer.freeRanges.end(); ++iter)
+	{
+		if (iter->second >= a_count)
+		{
+			a_offset = iter->first;
+			size_t remaining = iter->second - a_count;
+			a_buffer.freeRanges.erase(iter);
+			if (remaining > 0)
+			{
+				a_buffer.freeRanges[a_offset + a_count] = remaining;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void MeshPool::Free(PoolBuffer& a_buffer, size_t a_offset, size_t a_count)
+{
+	//merge with the free ranges on either side so large meshes can reuse the space
+	auto next = a_buffer.freeRanges.lower_bound(a_offset);
+	if (next != a_buffer.freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == a_offset)
+		{
+			a_offset = previous->first;
+			a_count += previous->second;
+			a_buffer.freeRanges.erase(previous);
+		}
+	}
+	if (next != a_buffer.freeRanges.end() && a_offset + a_count == next->first)
+	{
+		a_count += next->second;
+		a_buffer.freeRanges.erase(next);
+	}
+	a_buffer.freeRanges[a_offset] = a_count;
+}
+
+void MeshPool::Grow(PoolBuffer& a_buffer, size_t a_minCapacity)
+{
+	size_t capacity = std::max(std::max(a_buffer.capacity * 2, a_minCapacity), s_initialBufferBytes / a_buffer.elementSize);
+	unsigned int bufferID = 0;
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, capacity * a_buffer.elementSize, nullptr, 0);
+	if (a_buffer.bufferID != 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, a_buffer.bufferID);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, a_buffer.capacity * a_buffer.elementSize);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &a_buffer.bufferID);
+		MemoryTracker::Free(MemoryTracker::BufferData, "Mesh pool", a_buffer.capacity * a_buffer.elementSize);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	MemoryTracker::Allocate(MemoryTracker::BufferData, "Mesh pool", capacity * a_buffer.elementSize);
+
+	size_t oldCapacity = a_buffer.capacity;
+	a_buffer.bufferID = bufferID;
+	a_buffer.capacity = capacity;
+	Free(a_buffer, oldCapacity, capacity - oldCapacity);
+	UpdateVertexArrays();
+}
+
+void MeshPool::Release(PoolBuffer& a_buffer)
+{
+	if (a_buffer.bufferID != 0)
+	{
+		glDeleteBuffers(1, &a_buffer.bufferID);
+		MemoryTracker::Free(MemoryTracker::BufferData, "Mesh pool", a_buffer.capacity * a_buffer.elementSize);
+	}
+	a_buffer.bufferID = 0;
+	a_buffer.capacity = 0;
+	a_buffer.freeRanges.clear();
+}
+
+void MeshPool::UpdateVertexArrays()
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		if (m_vertexArrays[i] == 0)
+		{
+			//the same layout as the vertex arrays of individual meshes, with the vertex buffer on binding 0
+			glGenVertexArrays(1, &m_vertexArrays[i]);
+			glBindVertexArray(m_vertexArrays[i]);
+			glEnableVertexAttribArray(0); //position
+			glEnableVertexAttribArray(1); //normal
+			glEnableVertexAttribArray(2); //uv coord
+			glVertexAttribFormat(0, 4, GL_FLOAT, GL_FALSE, OBJVertex::PositionOffset);
+			glVertexAttribFormat(1, 4, GL_FLOAT, GL_TRUE, OBJVertex::NormalOffset);
+			glVertexAttribFormat(2, 2, GL_FLOAT, GL_TRUE, OBJVertex::UVCoordOffset);
+			glVertexAttribBinding(0, 0);
+			glVertexAttribBinding(1, 0);
+			glVertexAttribBinding(2, 0);
+			for (unsigned int column = 0; column < 4; ++column)
+			{
+				glEnableVertexAttribArray(m_instanceLocation + column);
+				glVertexAttribFormat(m_instanceLocation + column, 4, GL_FLOAT, GL_FALSE, column * sizeof(glm::vec4));
+				glVertexAttribBinding(m_instanceLocation + column, m_instanceBinding);
+			}
+			glVertexBindingDivisor(m_instanceBinding, 1);
+		}
+		glBindVertexArray(m_vertexArrays[i]);
+		glBindVertexBuffer(0, m_vertices.bufferID, 0, (GLsizei)m_vertices.elementSize);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices[i].bufferID);
+	}
+	//unbind the vertex array first so the element buffer binding stays recorded in it
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
@@ -1,12 +1,28 @@
 #include "ObjectRenderer.h"
 #include "ShaderUtil.h"
+#include "ShaderProgram.h"
+#include "UniformRingBuffer.h"
+#include "MeshPool.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
 #include "Dispatcher.h"
 #include "Utilities.h"
 #include "TextureManager.h"
 #include "Texture.h"
+#include "MemoryTracker.h"
+#include "AssetWatcher.h"
+#include "ThreadPool.h"
 #include "obj_Loader.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <unordered_map>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -18,6 +34,23 @@
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_glfw.h>
 
+//vertex buffer binding the per instance transforms are read from, after the bindings used by the mesh attributes
+static const unsigned int s_instanceBinding = 3;
+//attribute location of the first column of the per instance transform
+static const unsigned int s_instanceTransformLocation = 3;
+//triangles kept in the simplified copy of each mesh the occlusion culler draws
+static const unsigned int s_maxOccluderTriangles = 128;
+//meshes drawn into the occlusion culler's depth buffer each frame, and the fraction of the screen height a mesh's
+//bounds have to cover for it to be one of them
+static const size_t s_maxOccluders = 32;
+static const float s_minOccluderSize = 0.1f;
+//bounds tested against the occlusion culler's depth buffer by each job
+static const unsigned int s_occlusionTestChunk = 1024;
+//the automatic depth prepass compares the shading the prepass would save with the cost of drawing every triangle a
+//second time, counted as this many shaded pixels per triangle. The setting only changes once the difference is past
+//the margin so it doesn't flicker on and off when the two are close
+static const float s_prepassTriangleCost = 0.25f;
+static const float s_prepassMargin = 1.25f;
 
 ObjectRenderer::ObjectRenderer()
 {
@@ -35,9 +68,16 @@ bool ObjectRenderer::onCreate()
 	if (dp)
 	{
 		dp->Subscribe(this, &ObjectRenderer::onWindowResize);
+		dp->Subscribe(this, &ObjectRenderer::onAssetChanged);
 	}
+	//get an instance of the memory tracker before any resources are created so they are all accounted for
+	MemoryTracker::CreateInstance();
+	//start the worker threads that textures are decoded on before the texture manager uses them
+	ThreadPool::CreateInstance();
 	//get an instance of the texture manager
 	TextureManager::CreateInstance();
+	//watch the resource folder so shaders and textures can be edited while the application is running
+	AssetWatcher::CreateInstance()->WatchDirectory("./resource", true);
 
 	m_backgroundColour = glm::vec3(0.45f, 0.8f, 1.0f); //default light blue 0.45f, 0.8f, 1.0f, 1.0f
 
@@ -45,49 +85,55 @@ bool ObjectRenderer::onCreate()
 	glClearColor(m_backgroundColour.x, m_backgroundColour.y, m_backgroundColour.z, 1.0f);
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
-
-	//create shader program 
-	unsigned int vertexShader = ShaderUtil::loadShader("./resource/shaders/vertex.glsl", GL_VERTEX_SHADER);
-	unsigned int fragmentShader = ShaderUtil::loadShader("./resource/shaders/fragment.glsl", GL_FRAGMENT_SHADER);
-	m_uiProgram = ShaderUtil::createProgram(vertexShader, fragmentShader);
-
-#pragma region Grid Lines
-
-	//create a grid of lines to be drawn during our update
-	//create a 50x50 square grid
-	lines = new Line[240];
-
-	for (int i = 0, j = 0; i < 101; ++i, j += 2)
+	//filter across the edges of cube map faces so the skybox mips don't show seams
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	//create shader program for the ground grid, it is worked out in the fragment shader so it has no vertex data
+	//and only needs an empty vertex array to draw with
+	unsigned int vertexShader = ShaderUtil::loadShader("./resource/shaders/grid_vertex.glsl", GL_VERTEX_SHADER);
+	unsigned int fragmentShader = ShaderUtil::loadShader("./resource/shaders/grid_fragment.glsl", GL_FRAGMENT_SHADER);
+	m_gridProgram = ShaderUtil::createProgram(vertexShader, fragmentShader);
+	glGenVertexArrays(1, &m_gridVAO);
+	//the OBJ programs are created when the first model is loaded
+	m_objProgram = nullptr;
+	m_objArrayProgram = nullptr;
+	m_objDepthProgram = nullptr;
+
+	//uniform blocks for the OBJ shaders, the ring buffer grows if there are more actors than it has room for
+	m_frameUniforms = new UniformRingBuffer();
+	m_frameUniforms->Create(64 * 1024);
+	m_meshDrawCalls = 0;
+	m_indirectDraws = 0;
+	//multi-draw reads pooled copies of the meshes, the pool is filled when it is enabled
+	m_objMultiDrawProgram = nullptr;
+	m_meshPool = new MeshPool(s_instanceTransformLocation, s_instanceBinding);
+	m_drawCommands = new UniformRingBuffer();
+	m_drawCommands->Create(64 * 1024);
+	m_renderQueue = new RenderQueue();
+	m_frustumCuller = new FrustumCuller();
+	m_occlusionCuller = new OcclusionCuller();
+	m_occluderCount = 0;
+	m_occludedMeshes = 0;
+	m_occlusionTime = 0.0f;
+	m_testedMeshes = 0;
+	m_culledMeshes = 0;
+	m_cullTime = 0.0f;
+	//samples passed queries measure the overdraw the automatic depth prepass setting is decided from
+	glGenQueries(OverdrawQueryCount, m_overdrawQueries);
+	for (unsigned int i = 0; i < OverdrawQueryCount; ++i)
 	{
-		lines[j].v0.position = glm::vec4(-50 + i, 0.0f, 50.0f, 1.0f);
-		lines[j].v0.colour = (i == 50) ? glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-		lines[j].v1.position = glm::vec4(-50 + i, 0.0f, -50.0f, 1.0f);
-		lines[j].v1.colour = (i == 50) ? glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-
-		lines[j + 1].v0.position = glm::vec4(50, 0.0f, -50.0f + i, 1.0f);
-		lines[j + 1].v0.colour = (i == 50) ? glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-		lines[j + 1].v1.position = glm::vec4(-50, 0.0f, -50.0f + i, 1.0f);
-		lines[j + 1].v1.colour = (i == 50) ? glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		m_overdrawQueryPending[i] = false;
 	}
-
-	//create a vertex buffer to hold our line data
-	glGenBuffers(1, &m_lineVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_lineVBO);
-	//fill vertex buffer with line data
-	glBufferData(GL_ARRAY_BUFFER, 240 * sizeof(Line), lines, GL_STATIC_DRAW);
-
-	//enable the vertex array state, since we're sending in an array of verticies
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-
-	//specify where our vertex array is, how many components each vertex has, the data type of
-	//each compnent and whether the data is normalised or not
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), ((char*)0) + 16);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-#pragma endregion
+	m_overdrawQueryIndex = 0;
+	m_overdraw = 0.0f;
+	m_prepassTriangles = 0;
+	m_depthPrepassActive = false;
+	m_depthPrepassAuto = false;
+	MaterialUniforms defaultMaterial = { glm::vec4(0.25f, 0.25f, 0.25f, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 64.0f) };
+	glGenBuffers(1, &m_defaultMaterialUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_defaultMaterialUBO);
+	glBufferStorage(GL_UNIFORM_BUFFER, sizeof(MaterialUniforms), &defaultMaterial, 0);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
 	//create a world-space matrix for a camera
 	m_cameraMatrix = glm::inverse(glm::lookAt(glm::vec3(10, 10, 10), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)));
@@ -113,14 +159,15 @@ bool ObjectRenderer::onCreate()
 										  GL_TEXTURE_CUBE_MAP_POSITIVE_Z, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z };
 
 
-	Texture* pTexture = new Texture();
-	m_CubeMapTexID = pTexture->LoadCubeMap(textures_faces, cubemap_image_tag);
+	m_skyboxTexture = new Texture();
+	m_CubeMapTexID = m_skyboxTexture->LoadCubeMap(textures_faces, cubemap_image_tag);
+	MemoryTracker::Allocate(MemoryTracker::TextureData, "Skybox", m_skyboxTexture->GetMemoryUsage());
 
 	//make skybox VBO and VAO and load shaders for skybox
 	unsigned int sb_vertexShader = ShaderUtil::loadShader("./resource/shaders/SB_vertex.glsl", GL_VERTEX_SHADER);
 	unsigned int sb_fragmentShader = ShaderUtil::loadShader("./resource/shaders/SB_fragment.glsl", GL_FRAGMENT_SHADER);
 
-	m_SBProgramID = ShaderUtil::createProgram(sb_vertexShader, sb_fragmentShader);
+	m_SBProgram = ShaderUtil::createProgram(sb_vertexShader, sb_fragmentShader);
 
 	float skyboxVertices[] = {
 		// positions          
@@ -205,6 +252,11 @@ bool ObjectRenderer::onCreate()
 
 void ObjectRenderer::Update(float _deltaTime)
 {
+	//handle any assets that have changed on disk since the last frame
+	AssetWatcher::GetInstance()->Update();
+	//upload any textures that have finished decoding in the background
+	TextureManager::GetInstance()->Update();
+
 	Utility::freeMovement(m_cameraMatrix, _deltaTime, 2.0f);
 
 	UpdateGUI();
@@ -222,155 +274,461 @@ void ObjectRenderer::Draw()
 	glm::mat4 viewMatrix = glm::inverse(m_cameraMatrix);
 	glm::mat4 projectionViewMatrix = m_projectionMatrix * viewMatrix;
 
-	//enable shaders 
-	glUseProgram(m_uiProgram);
-
-	//send the projection matrix to the vertex shader
-	//ask the shader program for the location of the projection view matrix uniform variable
-	unsigned int projectionViewUniformLocation = glGetUniformLocation(m_uiProgram, "ProjectionViewMatrix");
-	//send this location a pointer to our glm::mat4 (send across float data)
-	glUniformMatrix4fv(projectionViewUniformLocation, 1, false, glm::value_ptr(projectionViewMatrix));
+#pragma region Object Mesh & Material
+	
 
-#pragma region Lines
+	//materials whose textures are all in texture arrays are drawn with the array program
+	TextureManager* pTM = TextureManager::GetInstance();
 
-	if (m_gridLinesEnabled)
+	//actors that share a model are drawn together, each mesh of the model once with an instance per actor
+	std::vector<OBJModel*> models;
+	std::vector<std::vector<int>> modelActors;
+	std::unordered_map<OBJModel*, size_t> modelGroups;
+	for (int i = 0; i < m_actorModels.size(); ++i)
 	{
-		//draw to the screen 
-		glBindBuffer(GL_ARRAY_BUFFER, m_lineVBO);
-		glBufferData(GL_ARRAY_BUFFER, 240 * sizeof(Line), lines, GL_STATIC_DRAW);
-
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-
-		//specify where our vertex array is, how many components each vertex has,
-		//the data type of each component and whether the data is normalised or not
-		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
-		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), ((char*)0) + 16);
-
-		glDrawArrays(GL_LINES, 0, 240 * 2);
+		if (m_actorModels[i] == nullptr) { continue; }
+		auto group = modelGroups.emplace(m_actorModels[i], models.size());
+		if (group.second)
+		{
+			models.push_back(m_actorModels[i]);
+			modelActors.emplace_back();
+		}
+		modelActors[group.first->second].push_back(i);
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//the transforms of every actor, grouped by model so each model's instances are consecutive. The matrices are
+	//cached and only rebuilt for actors that were moved since the last frame
+	UpdateActorMatrices();
+	std::vector<glm::mat4> transforms;
+	std::vector<size_t> groupStarts;
+	for (size_t group = 0; group < models.size(); ++group)
+	{
+		groupStarts.push_back(transforms.size());
+		for (auto iter = modelActors[group].begin(); iter != modelActors[group].end(); ++iter)
+		{
+			transforms.push_back(m_actorWorldMatrix[*iter]);
+		}
+	}
 
-		glUseProgram(0);
+	//test the bounds of every mesh of every actor against the frustum, meshes entirely outside of it aren't drawn.
+	//A mesh visible for all of its model's actors reads the model's transforms, one visible for only some of them
+	//has the transforms of those actors copied after the rest
+	double cullStart = glfwGetTime();
+	glm::vec3 cameraPosition = glm::vec3(m_cameraMatrix[3]);
+	bool testBounds = m_frustumCullingEnabled || m_occlusionCullingEnabled;
+	std::vector<size_t> meshStarts;
+	size_t meshCount = 0;
+	m_frustumCuller->Clear();
+	for (size_t group = 0; group < models.size(); ++group)
+	{
+		meshStarts.push_back(meshCount);
+		meshCount += models[group]->getMeshCount();
+		for (int i = 0; testBounds && i < models[group]->getMeshCount(); ++i)
+		{
+			OBJMesh* pMesh = models[group]->getMeshByIndex(i);
+			for (size_t n = 0; n < modelActors[group].size(); ++n)
+			{
+				m_frustumCuller->AddBounds(pMesh->m_boundsCentre, pMesh->m_boundsExtents, transforms[groupStarts[group] + n]);
+			}
+		}
 	}
+	unsigned int boundsCount = m_frustumCuller->GetBoundsCount();
+	std::vector<unsigned char> visible(boundsCount, 1);
+	m_culledMeshes = 0;
+	if (m_frustumCullingEnabled)
+	{
+		m_frustumCuller->SetFrustum(projectionViewMatrix);
+		m_culledMeshes = boundsCount - m_frustumCuller->Cull();
+		for (unsigned int b = 0; b < boundsCount; ++b)
+		{
+			visible[b] = m_frustumCuller->IsVisible(b) ? 1 : 0;
+		}
+	}
+	m_cullTime = (float)((glfwGetTime() - cullStart) * 1000.0);
+
+	//the meshes covering the most of the screen are drawn into a small software depth buffer, every other mesh in
+	//view whose bounds are entirely behind what was drawn is skipped
+	m_occluderCount = 0;
+	m_occludedMeshes = 0;
+	m_occlusionTime = 0.0f;
+	if (m_occlusionCullingEnabled)
+	{
+		double occlusionStart = glfwGetTime();
+		std::vector<Occluder> occluders;
+		unsigned int bounds = 0;
+		for (size_t group = 0; group < models.size(); ++group)
+		{
+			for (int i = 0; i < models[group]->getMeshCount(); ++i)
+			{
+				OBJMesh* pMesh = models[group]->getMeshByIndex(i);
+				for (size_t n = 0; n < modelActors[group].size(); ++n, ++bounds)
+				{
+					if (!visible[bounds] || pMesh->m_occluderTriangles.empty()) { continue; }
+					//rough fraction of the screen height the bounds cover, meshes the camera is inside of are
+					//mostly cut away by the near plane so they're left out
+					glm::vec3 centre, extents;
+					m_frustumCuller->GetBounds(bounds, centre, extents);
+					float distance = glm::length(centre - cameraPosition), radius = glm::length(extents);
+					if (distance <= radius) { continue; }
+					Occluder occluder = { radius * m_projectionMatrix[1][1] / distance, pMesh, groupStarts[group] + n, bounds };
+					if (occluder.screenSize >= s_minOccluderSize)
+					{
+						occluders.push_back(occluder);
+					}
+				}
+			}
+		}
+		size_t occluderCount = std::min(occluders.size(), s_maxOccluders);
+		std::partial_sort(occluders.begin(), occluders.begin() + occluderCount, occluders.end(),
+			[](const Occluder& a_lhs, const Occluder& a_rhs) { return a_lhs.screenSize > a_rhs.screenSize; });
+
+		//a flat occluder facing the camera has bounds as thin as the depth it writes, rounding would have it hide itself
+		//at random, so the occluders are always drawn
+		std::vector<unsigned char> testBounds(boundsCount, 1);
+		m_occlusionCuller->BeginFrame(projectionViewMatrix);
+		for (size_t n = 0; n < occluderCount; ++n)
+		{
+			m_occlusionCuller->AddOccluder(occluders[n].mesh->m_occluderTriangles, transforms[occluders[n].transform]);
+			testBounds[occluders[n].bounds] = 0;
+		}
+		m_occlusionCuller->Rasterize();
+		m_occluderCount = (unsigned int)occluderCount;
 
-#pragma endregion
+		//the tests only read the depth buffer so they are spread across the thread pool in chunks
+		if (occluderCount > 0)
+		{
+			unsigned int chunkCount = (boundsCount + s_occlusionTestChunk - 1) / s_occlusionTestChunk;
+			ThreadPool::GetInstance()->ParallelFor(chunkCount, [&](unsigned int a_chunk)
+			{
+				unsigned int end = std::min((a_chunk + 1) * s_occlusionTestChunk, boundsCount);
+				for (unsigned int b = a_chunk * s_occlusionTestChunk; b < end; ++b)
+				{
+					glm::vec3 centre, extents;
+					m_frustumCuller->GetBounds(b, centre, extents);
+					if (visible[b] && testBounds[b] && !m_occlusionCuller->IsVisible(centre, extents))
+					{
+						visible[b] = 0;
+					}
+				}
+			});
+			m_occludedMeshes = boundsCount - m_culledMeshes - (unsigned int)std::count(visible.begin(), visible.end(), 1);
+		}
+		m_occlusionTime = (float)((glfwGetTime() - occlusionStart) * 1000.0);
+	}
 
-#pragma region Object Mesh & Material
-	
+	std::vector<MeshInstances> meshInstances;
+	std::vector<unsigned int> visibleInstances;
+	meshInstances.reserve(meshCount);
+	unsigned int bounds = 0;
+	m_testedMeshes = 0;
+	for (size_t group = 0; group < models.size(); ++group)
+	{
+		const std::vector<int>& actors = modelActors[group];
+		for (int i = 0; i < models[group]->getMeshCount(); ++i)
+		{
+			MeshInstances instances = { (unsigned int)groupStarts[group], 0, (unsigned int)visibleInstances.size() };
+			for (size_t n = 0; n < actors.size(); ++n)
+			{
+				if (!testBounds || visible[bounds++])
+				{
+					visibleInstances.push_back((unsigned int)n);
+				}
+			}
+			instances.count = (unsigned int)(visibleInstances.size() - instances.visibleStart);
+			if (instances.count > 0 && instances.count < actors.size())
+			{
+				instances.first = (unsigned int)transforms.size();
+				for (unsigned int k = 0; k < instances.count; ++k)
+				{
+					glm::mat4 transform = transforms[groupStarts[group] + visibleInstances[instances.visibleStart + k]];
+					transforms.push_back(transform);
+				}
+			}
+			meshInstances.push_back(instances);
+			m_testedMeshes += (unsigned int)actors.size();
+		}
+	}
 
-	for (int i = 0; i < m_actorModels.size(); ++i)
+	//the camera and light are written once for the frame, the shaders read them from a uniform block. The transforms
+	//follow them in the same buffer and are read as a per instance vertex attribute
+	size_t frameBytes = m_frameUniforms->GetAlignedSize(sizeof(FrameUniforms)) + m_frameUniforms->GetAlignedSize(transforms.size() * sizeof(glm::mat4));
+	m_frameUniforms->BeginFrame(frameBytes);
+	size_t uniformOffset = 0;
+	FrameUniforms* pFrame = (FrameUniforms*)m_frameUniforms->Allocate(sizeof(FrameUniforms), uniformOffset);
+	if (pFrame != nullptr)
 	{
-		m_objModel = m_actorModels[i];
+		pFrame->projectionViewMatrix = projectionViewMatrix;
+		pFrame->cameraPosition = m_cameraMatrix[3];
+		pFrame->lightDirection = glm::normalize(glm::vec4(-10.0f, -8.0f, -10.0f, 0.0f));
+		glBindBufferRange(GL_UNIFORM_BUFFER, FrameBlock, m_frameUniforms->GetBufferID(), uniformOffset, sizeof(FrameUniforms));
+	}
+	//copy the transforms into the mapped buffer in one go, it is write combined memory that is slow to read back
+	size_t instanceOffset = 0;
+	void* pInstances = transforms.empty() ? nullptr : m_frameUniforms->Allocate(transforms.size() * sizeof(glm::mat4), instanceOffset);
+	if (pInstances != nullptr)
+	{
+		memcpy(pInstances, transforms.data(), transforms.size() * sizeof(glm::mat4));
+	}
+	else
+	{
+		models.clear();
+	}
+	m_meshDrawCalls = 0;
+	m_indirectDraws = 0;
+	//meshes in the pool whose textures are all in texture arrays are batched and drawn with multi-draw calls at the end
+	bool multiDraw = m_multiDrawEnabled && m_objMultiDrawProgram != nullptr;
+
+	//every other mesh becomes an item in the render queue, sorted so draws sharing a program, textures and material are
+	//consecutive. The textures and materials are given small IDs in the order they are first seen to fit in the key
+	m_drawItems.clear();
+	m_renderQueue->Clear();
+	std::unordered_map<uint64_t, unsigned int> textureSetIDs;
+	std::unordered_map<const OBJMaterial*, unsigned int> materialIDs;
+
+	for (size_t group = 0; group < models.size(); ++group)
+	{
+		m_objModel = models[group];
+		const std::vector<int>& actors = modelActors[group];
 
-		if (m_objModel)
+		for (int i = 0; i < m_objModel->getMeshCount(); ++i)
 		{
-			glUseProgram(m_objProgram);
-
-			//set the projection view matrix for this shader
-			projectionViewUniformLocation = glGetUniformLocation(m_objProgram, "ProjectionViewMatrix");
-			//send this location a pointer to our glm::mat4 (send across float data)
-			glUniformMatrix4fv(projectionViewUniformLocation, 1, false, glm::value_ptr(projectionViewMatrix));
+			OBJMesh* pMesh = m_objModel->getMeshByIndex(i);
+			OBJMaterial* pMaterial = pMesh->m_material;
+			const MeshInstances& instances = meshInstances[meshStarts[group] + i];
+			if (instances.count == 0) { continue; }
+
+			//find the array layer of every texture, textures that haven't been packed yet fall back to the 2D program
+			unsigned int arrayIDs[OBJMaterial::TextureTypes::TextureTypes_Count] = { 0 };
+			int arrayLayers[OBJMaterial::TextureTypes::TextureTypes_Count] = { -1, -1, -1 };
+			bool useArrays = (pMaterial != nullptr && m_textureArraysEnabled);
+			for (int n = 0; useArrays && n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+			{
+				if (pMaterial->textureIDs[n] != 0)
+				{
+					useArrays = pTM->GetTextureLayer(pMaterial->textureIDs[n], arrayIDs[n], arrayLayers[n]);
+				}
+			}
 
-			int index = GetActorIndex(m_actors[i]);
-			for (int i = 0; i < m_objModel->getMeshCount(); ++i)
+			if (pMaterial != nullptr)
 			{
-				//use a mat4 to set position, rotation and scale
-				glm::mat4 trans = glm::mat4(1.0f);
+				//array layers hold the levels streamed for their texture, so every drawn texture asks for the detail it needs
+				for (unsigned int k = 0; k < instances.count; ++k)
+				{
+					unsigned int n = visibleInstances[instances.visibleStart + k];
+					RequestTextureDetail(pMesh, transforms[groupStarts[group] + n], m_actorScale[actors[n]]);
+				}
+			}
 
-				//apply translation for the objects position
-				trans = glm::translate(trans, glm::vec3(m_actorPosition[index][0], m_actorPosition[index][2], m_actorPosition[index][1])); //switch around Y and Z axis to be correct
+			if (multiDraw && pMesh->m_inMeshPool && (useArrays || pMaterial == nullptr))
+			{
+				//find a batch that already reads the same arrays, the index size decides which pooled index buffer is read
+				auto batch = m_drawBatches.begin();
+				for (; batch != m_drawBatches.end(); ++batch)
+				{
+					if (batch->shortIndices == pMesh->usesShortIndices() && std::equal(arrayIDs, arrayIDs + OBJMaterial::TextureTypes::TextureTypes_Count, batch->arrayIDs))
+					{
+						break;
+					}
+				}
+				if (batch == m_drawBatches.end())
+				{
+					DrawBatch newBatch = { { arrayIDs[0], arrayIDs[1], arrayIDs[2] }, pMesh->usesShortIndices() };
+					batch = m_drawBatches.insert(m_drawBatches.end(), newBatch);
+				}
+				DrawElementsIndirectCommand command = { pMesh->getIndexCount(), instances.count, pMesh->m_poolFirstIndex, (int)pMesh->m_poolBaseVertex, instances.first };
+				DrawUniforms draw = { glm::vec4(0.25f, 0.25f, 0.25f, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 64.0f), glm::ivec4(-1) };
+				if (pMaterial != nullptr)
+				{
+					draw = { pMaterial->kA, pMaterial->kD, pMaterial->kS, glm::ivec4(arrayLayers[0], arrayLayers[1], arrayLayers[2], 0) };
+				}
+				batch->commands.push_back(command);
+				batch->draws.push_back(draw);
+				continue;
+			}
 
-				//apply rotation for each axis
-				trans = glm::rotate(trans, glm::radians(m_actorRotation[index][0]), glm::vec3(1.0, 0.0, 0.0));
-				trans = glm::rotate(trans, glm::radians(m_actorRotation[index][1]), glm::vec3(0.0, 1.0, 0.0));
-				trans = glm::rotate(trans, glm::radians(m_actorRotation[index][2]), glm::vec3(0.0, 0.0, 1.0));
+			DrawItem item = { pMesh, instances.first, instances.count, useArrays, { 0, 0, 0 }, { arrayLayers[0], arrayLayers[1], arrayLayers[2] },
+				m_defaultMaterialUBO, 0 };
+			if (pMaterial != nullptr)
+			{
+				for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+				{
+					item.textureIDs[n] = useArrays ? arrayIDs[n] : pMaterial->textureIDs[n];
+				}
+				//meshes of the same material share its range of the model's material table
+				if (pMaterial->uniformBufferID != 0)
+				{
+					item.materialBuffer = pMaterial->uniformBufferID;
+					item.materialOffset = pMaterial->uniformOffset;
+				}
+			}
 
-				//apply the scale factor
-				trans = glm::scale(trans, glm::vec3(m_actorScale[index]));
+			//texture names are small so packing them can only collide in scenes with millions of textures, which only costs sorting quality
+			uint64_t textureSet = (uint64_t)item.textureIDs[0] | ((uint64_t)item.textureIDs[1] << 21) | ((uint64_t)item.textureIDs[2] << 42);
+			unsigned int textureSetID = textureSetIDs.emplace(textureSet, (unsigned int)textureSetIDs.size()).first->second;
+			unsigned int materialID = materialIDs.emplace(pMaterial, (unsigned int)materialIDs.size()).first->second;
+			unsigned int state = (std::min(textureSetID, 0xFFFu) << 12) | std::min(materialID, 0xFFFu);
 
-				//get the model matrix location from the shader program
-				int modelMatrixUniformLocation = glGetUniformLocation(m_objProgram, "transform");
-				//send the OBJ Model's world matrix data across to the shader program
-				glUniformMatrix4fv(modelMatrixUniformLocation, 1, false, glm::value_ptr(trans));
+			//sort by the nearest instance so the closest meshes of each state are drawn first and hide the ones behind
+			float depth = FLT_MAX;
+			for (unsigned int k = 0; k < instances.count; ++k)
+			{
+				glm::vec3 centre = glm::vec3(transforms[instances.first + k] * glm::vec4(pMesh->m_boundsCentre, 1.0f));
+				depth = std::min(depth, glm::length(centre - cameraPosition));
+			}
 
-				int cameraPositionUniformLocation = glGetUniformLocation(m_objProgram, "camPos");
-				glUniform4fv(cameraPositionUniformLocation, 1, glm::value_ptr(m_cameraMatrix[3]));
+			m_renderQueue->Push(RenderQueue::MakeKey(OpaquePass, useArrays ? 1 : 0, state, depth), (unsigned int)m_drawItems.size());
+			m_drawItems.push_back(item);
+		}
+	}
+	m_renderQueue->Sort();
+	const std::vector<RenderQueue::Item>& items = m_renderQueue->GetItems();
 
-				OBJMesh* pMesh = m_objModel->getMeshByIndex(i);
-				//send material data to shader
-				int kA_location = glGetUniformLocation(m_objProgram, "kA");
-				int kD_location = glGetUniformLocation(m_objProgram, "kD");
-				int kS_location = glGetUniformLocation(m_objProgram, "kS");
+	//decide whether to lay down depth first, from the settings or from the overdraw measured in earlier frames
+	m_prepassTriangles = 0;
+	for (auto iter = m_drawItems.begin(); iter != m_drawItems.end(); ++iter)
+	{
+		m_prepassTriangles += iter->mesh->getIndexCount() / 3 * iter->instanceCount;
+	}
+	UpdateDepthPrepass();
+	m_depthPrepassActive = m_objDepthProgram != nullptr && !items.empty() &&
+		(m_depthPrepassMode == PrepassOn || (m_depthPrepassMode == PrepassAuto && m_depthPrepassAuto));
+
+	//count the fragments passing the depth test in the first pass over the queue, with nothing drawn before it that
+	//is every fragment the main pass shades when there is no prepass
+	bool measureOverdraw = !items.empty() && !m_overdrawQueryPending[m_overdrawQueryIndex];
+	if (measureOverdraw)
+	{
+		glBeginQuery(GL_SAMPLES_PASSED, m_overdrawQueries[m_overdrawQueryIndex]);
+	}
 
-				OBJMaterial* pMaterial = pMesh->m_material;
-				if (pMaterial != nullptr)
-				{
-					//send the OBJ Model's world matrix data across to the shader program
-					glUniform4fv(kA_location, 1, glm::value_ptr(pMaterial->kA));
-					glUniform4fv(kD_location, 1, glm::value_ptr(pMaterial->kD));
-					glUniform4fv(kS_location, 1, glm::value_ptr(pMaterial->kS));
-
-					//get the location of the diffuse texture
-					int texUniformLoc = glGetUniformLocation(m_objProgram, "DiffuseTexture");
-					glUniform1i(texUniformLoc, 0); //set diffuse texture to be GL_Texture0
-
-					glActiveTexture(GL_TEXTURE0); //set the active texture unit to texture0
-					//bind the texture for diffuse for this material to the texture0
-					glBindTexture(GL_TEXTURE_2D, pMaterial->textureIDs[OBJMaterial::TextureTypes::DiffuseTexture]);
-
-					//get the location of the specular texture
-					texUniformLoc = glGetUniformLocation(m_objProgram, "SpecularTexture");
-					glUniform1i(texUniformLoc, 1); //set diffuse texture to be gl_texture1
-
-					glActiveTexture(GL_TEXTURE1); //set the active texture unit to texture1
-					//bind the texture for specular for this material to the texture1
-					glBindTexture(GL_TEXTURE_2D, pMaterial->textureIDs[OBJMaterial::TextureTypes::SpecularTexture]);
-
-					//get the location of the normal texture
-					texUniformLoc = glGetUniformLocation(m_objProgram, "NormalTexture");
-					glUniform1i(texUniformLoc, 2); //set normal texture to be GL_Texture2
-
-					glActiveTexture(GL_TEXTURE2); //set the active texture unit to texture2
-					//bind the texture for specular for this material to the texture2
-					glBindTexture(GL_TEXTURE_2D, pMaterial->textureIDs[OBJMaterial::TextureTypes::NormalTexture]);
-				}
-				else //no material to obtain lighting information from use defaults
-				{
-					//send the OBJ Model's world matrix data across to the shader program
-					glUniform4fv(kA_location, 1, glm::value_ptr(glm::vec4(0.25f, 0.25f, 0.25f, 1.0f)));
-					glUniform4fv(kD_location, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
-					glUniform4fv(kS_location, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 64.0f)));
-				}
+	if (m_depthPrepassActive)
+	{
+		//draw the depth of every queued item from positions alone without writing colour, the main pass then only
+		//shades the fragments whose depth is equal to the nearest one
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		m_objDepthProgram->Use();
+		unsigned int depthVertexArray = 0;
+		size_t depthInstanceOffset = 0;
+		for (auto iter = items.begin(); iter != items.end(); ++iter)
+		{
+			const DrawItem& item = m_drawItems[iter->index];
+			size_t itemInstanceOffset = instanceOffset + item.firstInstance * sizeof(glm::mat4);
+			if (item.mesh->m_depthVertexArrayID != depthVertexArray || itemInstanceOffset != depthInstanceOffset)
+			{
+				glBindVertexArray(item.mesh->m_depthVertexArrayID);
+				glBindVertexBuffer(s_instanceBinding, m_frameUniforms->GetBufferID(), itemInstanceOffset, sizeof(glm::mat4));
+				depthVertexArray = item.mesh->m_depthVertexArrayID;
+				depthInstanceOffset = itemInstanceOffset;
+			}
+			glDrawElementsInstanced(GL_TRIANGLES, item.mesh->getIndexCount(), item.mesh->usesShortIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, 0, (GLsizei)item.instanceCount);
+			++m_meshDrawCalls;
+		}
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-				glBindBuffer(GL_ARRAY_BUFFER, m_objModelBuffer[0]);
-				glBufferData(GL_ARRAY_BUFFER, pMesh->m_vertices.size() * sizeof(OBJVertex), pMesh->m_vertices.data(), GL_STATIC_DRAW);
+		if (measureOverdraw)
+		{
+			glEndQuery(GL_SAMPLES_PASSED);
+		}
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
 
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_objModelBuffer[1]);
-				glEnableVertexAttribArray(0); //position
-				glEnableVertexAttribArray(1); //normal
-				glEnableVertexAttribArray(2); //uv coord
+	//walk the sorted items and only change the state that differs from the previous draw
+	ShaderProgram* currentProgram = nullptr;
+	//uniform locations and sampler units of the current program, looked up from its reflected table when it changes
+	int textureLayersLocation = -1;
+	int textureUnits[OBJMaterial::TextureTypes::TextureTypes_Count] = { -1, -1, -1 };
+	static const char* s_samplerNames[OBJMaterial::TextureTypes::TextureTypes_Count] = { "DiffuseTexture", "SpecularTexture", "NormalTexture" };
+	//textures bound to each unit, 2D textures and arrays are separate bindings of a unit so they are tracked separately.
+	//Whatever the last frame left bound is unknown, so every unit starts out needing a bind
+	const int maxTrackedUnits = 16;
+	unsigned int boundTextures[maxTrackedUnits], boundArrays[maxTrackedUnits];
+	std::fill(boundTextures, boundTextures + maxTrackedUnits, UINT_MAX);
+	std::fill(boundArrays, boundArrays + maxTrackedUnits, UINT_MAX);
+	glm::ivec3 boundLayers = glm::ivec3(-2);
+	unsigned int boundMaterialBuffer = 0, boundMaterialOffset = 0;
+	unsigned int boundVertexArray = 0;
+	size_t boundInstanceOffset = 0;
+
+	for (auto iter = items.begin(); iter != items.end(); ++iter)
+	{
+		const DrawItem& item = m_drawItems[iter->index];
+		OBJMesh* pMesh = item.mesh;
 
-				glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(OBJVertex), ((char*)0) + OBJVertex::PositionOffset);
-				glVertexAttribPointer(1, 4, GL_FLOAT, GL_TRUE, sizeof(OBJVertex), ((char*)0) + OBJVertex::NormalOffset);
-				glVertexAttribPointer(2, 2, GL_FLOAT, GL_TRUE, sizeof(OBJVertex), ((char*)0) + OBJVertex::UVCoordOffset);
+		ShaderProgram* program = item.useArrays ? m_objArrayProgram : m_objProgram;
+		if (program != currentProgram)
+		{
+			currentProgram = program;
+			program->Use();
 
-				glBufferData(GL_ELEMENT_ARRAY_BUFFER, pMesh->m_indicies.size() * sizeof(unsigned int), pMesh->m_indicies.data(), GL_STATIC_DRAW);
-				glDrawElements(GL_TRIANGLES, pMesh->m_indicies.size(), GL_UNSIGNED_INT, 0);
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			textureLayersLocation = program->GetUniformLocation("TextureLayers");
+			boundLayers = glm::ivec3(-2);
+			//the samplers were given their texture units when the program was linked, textures are bound to those
+			for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+			{
+				textureUnits[n] = program->GetSamplerUnit(s_samplerNames[n]);
 			}
+		}
 
-			glDisableVertexAttribArray(0);
-			glDisableVertexAttribArray(1);
-			glDisableVertexAttribArray(2);
+		if (item.materialBuffer != boundMaterialBuffer || item.materialOffset != boundMaterialOffset)
+		{
+			glBindBufferRange(GL_UNIFORM_BUFFER, MaterialBlock, item.materialBuffer, item.materialOffset, sizeof(MaterialUniforms));
+			boundMaterialBuffer = item.materialBuffer;
+			boundMaterialOffset = item.materialOffset;
+		}
 
-			glUseProgram(0);
+		//only the layers change between materials whose textures share arrays
+		glm::ivec3 layers = glm::ivec3(item.textureLayers[0], item.textureLayers[1], item.textureLayers[2]);
+		if (item.useArrays && layers != boundLayers)
+		{
+			program->SetUniform(textureLayersLocation, layers);
+			boundLayers = layers;
+		}
+		//bind the diffuse, specular and normal textures to the units the program's samplers read from
+		for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+		{
+			int unit = textureUnits[n];
+			if (unit < 0 || unit >= maxTrackedUnits) { continue; }
+			unsigned int* bound = item.useArrays ? boundArrays : boundTextures;
+			//a missing texture leaves whatever array is bound as its layer is never sampled, a 2D slot is cleared so it samples black
+			if ((item.useArrays && item.textureIDs[n] == 0) || bound[unit] == item.textureIDs[n]) { continue; }
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(item.useArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, item.textureIDs[n]);
+			bound[unit] = item.textureIDs[n];
 		}
-	}
 
+		//the mesh data was uploaded once at load time, bind its vertex array and its model's transforms then draw
+		//every actor using the model with whichever index size the loader chose for this mesh
+		size_t itemInstanceOffset = instanceOffset + item.firstInstance * sizeof(glm::mat4);
+		if (pMesh->m_vertexArrayID != boundVertexArray || itemInstanceOffset != boundInstanceOffset)
+		{
+			glBindVertexArray(pMesh->m_vertexArrayID);
+			glBindVertexBuffer(s_instanceBinding, m_frameUniforms->GetBufferID(), itemInstanceOffset, sizeof(glm::mat4));
+			boundVertexArray = pMesh->m_vertexArrayID;
+			boundInstanceOffset = itemInstanceOffset;
+		}
+		glDrawElementsInstanced(GL_TRIANGLES, pMesh->getIndexCount(), pMesh->usesShortIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, 0, (GLsizei)item.instanceCount);
+		++m_meshDrawCalls;
+	}
+	glBindVertexArray(0);
 
+	if (m_depthPrepassActive)
+	{
+		//the multi-drawn meshes weren't in the prepass so they test and write depth as usual
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+	}
+	else if (measureOverdraw)
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+	}
+	if (measureOverdraw)
+	{
+		m_overdrawQueryPending[m_overdrawQueryIndex] = true;
+		m_overdrawQueryIndex = (m_overdrawQueryIndex + 1) % OverdrawQueryCount;
+	}
 
+	SubmitDrawBatches(instanceOffset);
 
 #pragma endregion
 
@@ -380,15 +738,13 @@ void ObjectRenderer::Draw()
 	{
 		//draw skybox
 		glDepthFunc(GL_LEQUAL);
-		glUseProgram(m_SBProgramID);
+		m_SBProgram->Use();
 		glDepthMask(GL_FALSE);
 
-		projectionViewUniformLocation = glGetUniformLocation(m_SBProgramID, "ProjectionViewMatrix");
-		//send this location a pointer to our glm::mat4 (send across float data)
-		glUniformMatrix4fv(projectionViewUniformLocation, 1, false, glm::value_ptr(projectionViewMatrix));
+		m_SBProgram->SetUniform(m_SBProgram->GetUniformLocation("ProjectionViewMatrix"), projectionViewMatrix);
 
 		glBindVertexArray(m_SBVAO);
-		glActiveTexture(GL_TEXTURE0);
+		glActiveTexture(GL_TEXTURE0 + m_SBProgram->GetSamplerUnit("skybox"));
 		glBindTexture(GL_TEXTURE_CUBE_MAP, m_CubeMapTexID);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
 
@@ -401,16 +757,158 @@ void ObjectRenderer::Draw()
 
 #pragma endregion
 
+#pragma region Grid
+
+	if (m_gridLinesEnabled)
+	{
+		//the grid covers the ground out to where it fades away and is blended over the scene after everything
+		//else, each pixel is tested against the depth of the point on the ground it shows but doesn't write it
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_FALSE);
+		m_gridProgram->Use();
+
+		glBindVertexArray(m_gridVAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		glBindVertexArray(0);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+		glUseProgram(0);
+	}
+
+#pragma endregion
+
+	//the grid reads the frame's uniforms too, so the frame ends once it has been drawn
+	m_frameUniforms->EndFrame();
+}
+
+void ObjectRenderer::SubmitDrawBatches(size_t _instanceOffset)
+{
+	size_t commandBytes = 0;
+	for (auto batch = m_drawBatches.begin(); batch != m_drawBatches.end(); ++batch)
+	{
+		commandBytes += m_drawCommands->GetAlignedSize(batch->commands.size() * sizeof(DrawElementsIndirectCommand)) +
+			m_drawCommands->GetAlignedSize(batch->draws.size() * sizeof(DrawUniforms));
+	}
+
+	if (commandBytes > 0)
+	{
+		m_drawCommands->BeginFrame(commandBytes);
+		m_objMultiDrawProgram->Use();
+		static const char* s_samplerNames[OBJMaterial::TextureTypes::TextureTypes_Count] = { "DiffuseTexture", "SpecularTexture", "NormalTexture" };
+		int textureUnits[OBJMaterial::TextureTypes::TextureTypes_Count];
+		for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+		{
+			textureUnits[n] = m_objMultiDrawProgram->GetSamplerUnit(s_samplerNames[n]);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawCommands->GetBufferID());
+
+		for (auto batch = m_drawBatches.begin(); batch != m_drawBatches.end(); ++batch)
+		{
+			if (batch->commands.empty()) { continue; }
+
+			//the commands are read from the indirect buffer and each draw's material from the storage block, by its draw ID
+			size_t commandOffset = 0, drawOffset = 0;
+			void* pCommands = m_drawCommands->Allocate(batch->commands.size() * sizeof(DrawElementsIndirectCommand), commandOffset);
+			void* pDraws = m_drawCommands->Allocate(batch->draws.size() * sizeof(DrawUniforms), drawOffset);
+			if (pCommands == nullptr || pDraws == nullptr) { break; }
+			memcpy(pCommands, batch->commands.data(), batch->commands.size() * sizeof(DrawElementsIndirectCommand));
+			memcpy(pDraws, batch->draws.data(), batch->draws.size() * sizeof(DrawUniforms));
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_drawCommands->GetBufferID(), drawOffset, batch->draws.size() * sizeof(DrawUniforms));
+
+			for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+			{
+				if (textureUnits[n] >= 0 && batch->arrayIDs[n] != 0)
+				{
+					glActiveTexture(GL_TEXTURE0 + textureUnits[n]);
+					glBindTexture(GL_TEXTURE_2D_ARRAY, batch->arrayIDs[n]);
+				}
+			}
+
+			//the base instance of each command picks its model's transforms out of the frame's instance data
+			glBindVertexArray(m_meshPool->GetVertexArrayID(batch->shortIndices));
+			glBindVertexBuffer(s_instanceBinding, m_frameUniforms->GetBufferID(), _instanceOffset, sizeof(glm::mat4));
+			glMultiDrawElementsIndirect(GL_TRIANGLES, batch->shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (const void*)commandOffset, (GLsizei)batch->commands.size(), 0);
+			++m_meshDrawCalls;
+			m_indirectDraws += (unsigned int)batch->commands.size();
+		}
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		m_drawCommands->EndFrame();
+	}
+
+	//batches are kept between frames so their arrays don't need reallocating, ones that weren't used this frame are dropped
+	m_drawBatches.erase(std::remove_if(m_drawBatches.begin(), m_drawBatches.end(), [](const DrawBatch& a_batch) { return a_batch.commands.empty(); }), m_drawBatches.end());
+	for (auto batch = m_drawBatches.begin(); batch != m_drawBatches.end(); ++batch)
+	{
+		batch->commands.clear();
+		batch->draws.clear();
+	}
+}
+
+void ObjectRenderer::RequestTextureDetail(const OBJMesh* _mesh, const glm::mat4& _transform, float _scale)
+{
+	if (_mesh->m_uvDensity <= 0.0f || m_windowHeight == 0) { return; }
+
+	glm::vec3 centre = glm::vec3(_transform * glm::vec4(_mesh->m_boundsCentre, 1.0f));
+	float scale = std::max(fabsf(_scale), 0.0001f);
+	float radius = _mesh->m_boundsRadius * scale;
+	glm::vec3 toMesh = centre - glm::vec3(m_cameraMatrix[3]);
+	//meshes entirely behind the camera don't need any detail
+	if (glm::dot(toMesh, -glm::vec3(m_cameraMatrix[2])) < -radius) { return; }
+
+	//size of a pixel at the nearest point of the mesh's bounds, converted to texture coordinates
+	float distance = std::max(glm::length(toMesh) - radius, 0.1f);
+	float pixelsPerUnit = m_windowHeight * 0.5f * m_projectionMatrix[1][1] / distance;
+	float uvPerPixel = _mesh->m_uvDensity / scale / pixelsPerUnit;
+
+	TextureManager* pTM = TextureManager::GetInstance();
+	for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+	{
+		if (_mesh->m_material->textureIDs[n] != 0)
+		{
+			pTM->RequestTextureDetail(_mesh->m_material->textureIDs[n], uvPerPixel);
+		}
+	}
 }
 
 void ObjectRenderer::Destroy()
 {
-	delete m_objModel;
-	delete[] lines;
-	glDeleteBuffers(1, &m_lineVBO);
-	ShaderUtil::deleteProgram(m_uiProgram);
+	//stop watching for changes before the resources they would reload are destroyed
+	AssetWatcher::DestroyInstance();
+	for (auto iter = m_loadedModels.begin(); iter != m_loadedModels.end(); ++iter)
+	{
+		UnloadModel(iter->first, iter->second);
+		delete iter->first;
+	}
+	m_loadedModels.clear();
+	m_actorModels.clear();
+	m_objModel = nullptr;
+	glDeleteVertexArrays(1, &m_gridVAO);
+	delete m_frameUniforms;
+	m_frameUniforms = nullptr;
+	delete m_drawCommands;
+	m_drawCommands = nullptr;
+	delete m_meshPool;
+	m_meshPool = nullptr;
+	delete m_renderQueue;
+	m_renderQueue = nullptr;
+	delete m_frustumCuller;
+	m_frustumCuller = nullptr;
+	delete m_occlusionCuller;
+	m_occlusionCuller = nullptr;
+	glDeleteQueries(OverdrawQueryCount, m_overdrawQueries);
+	glDeleteBuffers(1, &m_defaultMaterialUBO);
+	MemoryTracker::Free(MemoryTracker::TextureData, "Skybox", m_skyboxTexture->GetMemoryUsage());
+	delete m_skyboxTexture;
+	m_skyboxTexture = nullptr;
+	ShaderUtil::deleteProgram(m_gridProgram);
 	TextureManager::DestroyInstance();
+	ThreadPool::DestroyInstance();
 	ShaderUtil::DestroyInstance();
+	MemoryTracker::DestroyInstance();
 }
 
 void ObjectRenderer::onWindowResize(WindowResizeEvent* e)
@@ -420,44 +918,100 @@ void ObjectRenderer::onWindowResize(WindowResizeEvent* e)
 		//create a perspective projection matrix with a 90 degree field of view and widescreen aspect ratio
 		m_projectionMatrix = glm::perspective(glm::pi<float>() * 0.25f, e->GetWidth() / (float)e->GetHeight(), 0.1f, 1000.0f);
 		glViewport(0, 0, e->GetWidth(), e->GetHeight());
+		m_windowWidth = e->GetWidth();
+		m_windowHeight = e->GetHeight();
 	}
 
 	e->Handled();
 }
 
-void ObjectRenderer::LoadModel(std::string _filename)
+void ObjectRenderer::onAssetChanged(AssetChangedEvent* e)
 {
-	m_objModel = new OBJModel();
-	if (m_objModel->load(_filename.c_str()), 0.1f)
+	const std::string& path = e->GetPath();
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	if (extension == ".glsl")
+	{
+		//programs are relinked in place so the program IDs held here stay valid
+		unsigned int relinked = ShaderUtil::reloadShaderFile(path);
+		std::cout << "Reloaded shader: " << path << " (" << relinked << " program(s) relinked)" << std::endl;
+	}
+	else if (extension == ".obj" || extension == ".mtl")
 	{
+		//it isn't known which models use a material library, so reload every model in the same folder
+		std::string directory = std::filesystem::path(path).parent_path().generic_string();
+		for (auto iter = m_loadedModels.begin(); iter != m_loadedModels.end(); ++iter)
+		{
+			std::string modelFile = Utility::normalisePath(iter->second);
+			if ((extension == ".obj" && modelFile == path) ||
+				(extension == ".mtl" && std::filesystem::path(modelFile).parent_path().generic_string() == directory))
+			{
+				ReloadModel(iter->first, iter->second);
+			}
+		}
+	}
+	else
+	{
+		TextureManager::GetInstance()->ReloadTexture(path);
 
-		TextureManager* pTM = TextureManager::GetInstance();
-		//load in texture for model if any are present
-		for (int i = 0; i < m_objModel->GetMaterialCount(); ++i)
+		const std::vector<std::string>& faces = m_skyboxTexture->GetCubeMapFaces();
+		for (auto iter = faces.begin(); iter != faces.end(); ++iter)
 		{
-			OBJMaterial* mat = m_objModel->getMaterialByIndex(i);
-			for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+			if (Utility::normalisePath(*iter) == path)
 			{
-				if (mat->textureFileNames[n].size() > 0)
-				{
-					unsigned int textureID = pTM->LoadTexture(mat->textureFileNames[n].c_str());
-					mat->textureIDs[n] = textureID;
-				}
+				MemoryTracker::Free(MemoryTracker::TextureData, "Skybox", m_skyboxTexture->GetMemoryUsage());
+				m_skyboxTexture->Reload();
+				MemoryTracker::Allocate(MemoryTracker::TextureData, "Skybox", m_skyboxTexture->GetMemoryUsage());
+				break;
 			}
 		}
+	}
+
+	e->Handled();
+}
 
-		//setup shaders for OBJ Model rendering
-		unsigned int obj_vertexShader = ShaderUtil::loadShader("./resource/shaders/obj_vertex.glsl", GL_VERTEX_SHADER);
-		unsigned int obj_fragmentShader = ShaderUtil::loadShader("./resource/shaders/obj_fragment.glsl", GL_FRAGMENT_SHADER);
-		//create OBJ shader program
-		m_objProgram = ShaderUtil::createProgram(obj_vertexShader, obj_fragmentShader);
-		//set up vertex and index buffer for OBJ rendering
-		glGenBuffers(2, m_objModelBuffer);
-		//set up vertex buffer date
-		glBindBuffer(GL_ARRAY_BUFFER, m_objModelBuffer[0]);
+void ObjectRenderer::LoadModel(std::string _filename)
+{
+	m_objModel = new OBJModel();
+	m_objModel->setOutOfCore(m_outOfCoreEnabled, (size_t)m_outOfCoreMemoryCapMB * 1024 * 1024);
+	m_objModel->setSplitMeshes(m_splitMeshesEnabled);
+	m_objModel->setGeometryCache(m_geometryCacheEnabled);
+	TextureManager::GetInstance()->SetCompressionEnabled(m_textureCompressionEnabled);
+	if (m_objModel->load(_filename.c_str(), 0.1f))
+	{
+		m_loadedModels.push_back(std::make_pair(m_objModel, _filename));
+		UploadModel(m_objModel, _filename);
+		LoadModelMaterials(m_objModel, _filename);
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		//watch the model and the folder it was loaded from so edits to it, its materials or textures are reloaded
+		AssetWatcher* pWatcher = AssetWatcher::GetInstance();
+		pWatcher->WatchFile(_filename);
+		pWatcher->WatchDirectory(std::filesystem::path(_filename).parent_path().string(), false);
 
+		//setup shaders for OBJ Model rendering, every model shares the same programs so they are only created once
+		if (m_objProgram == nullptr)
+		{
+			unsigned int obj_vertexShader = ShaderUtil::loadShader("./resource/shaders/obj_vertex.glsl", GL_VERTEX_SHADER);
+			unsigned int obj_fragmentShader = ShaderUtil::loadShader("./resource/shaders/obj_fragment.glsl", GL_FRAGMENT_SHADER);
+			//create OBJ shader program
+			m_objProgram = ShaderUtil::createProgram(obj_vertexShader, obj_fragmentShader);
+			//the same vertex shader with textures read from texture arrays
+			unsigned int obj_arrayFragmentShader = ShaderUtil::loadShader("./resource/shaders/obj_array_fragment.glsl", GL_FRAGMENT_SHADER);
+			m_objArrayProgram = ShaderUtil::createProgram(obj_vertexShader, obj_arrayFragmentShader);
+			//the multi-draw program reads each draw's material by its draw ID, drivers without shader draw parameters
+			//fail to build it and meshes are then always drawn one at a time
+			unsigned int obj_multiDrawVertexShader = ShaderUtil::loadShader("./resource/shaders/obj_mdi_vertex.glsl", GL_VERTEX_SHADER);
+			unsigned int obj_multiDrawFragmentShader = ShaderUtil::loadShader("./resource/shaders/obj_mdi_fragment.glsl", GL_FRAGMENT_SHADER);
+			if (obj_multiDrawVertexShader != 0 && obj_multiDrawFragmentShader != 0)
+			{
+				m_objMultiDrawProgram = ShaderUtil::createProgram(obj_multiDrawVertexShader, obj_multiDrawFragmentShader);
+			}
+			//the depth prepass program reads the position only vertex arrays
+			unsigned int obj_depthVertexShader = ShaderUtil::loadShader("./resource/shaders/obj_depth_vertex.glsl", GL_VERTEX_SHADER);
+			unsigned int obj_depthFragmentShader = ShaderUtil::loadShader("./resource/shaders/obj_depth_fragment.glsl", GL_FRAGMENT_SHADER);
+			m_objDepthProgram = ShaderUtil::createProgram(obj_depthVertexShader, obj_depthFragmentShader);
+		}
 
 		std::string newName = "Actor";
 
@@ -467,6 +1021,8 @@ void ObjectRenderer::LoadModel(std::string _filename)
 		m_actorPosition.push_back({ 0.0f, 0.0f, 0.0f });
 		m_actorRotation.push_back({ 0.0f, 0.0f, 0.0f });
 		m_actorScale.push_back(1.0f);
+		m_actorWorldMatrix.push_back(glm::mat4(1.0f));
+		m_actorMatrixDirty.push_back(true);
 
 		std::vector<std::string> currentActors = m_actors;
 
@@ -494,7 +1050,409 @@ void ObjectRenderer::LoadModel(std::string _filename)
 	else
 	{
 		std::cout << "Failed to load model" << std::endl;
+		delete m_objModel;
+		m_objModel = nullptr;
+	}
+}
+
+//upload data to the buffer bound to a_target, if the buffer is already the right size it is updated in place rather
+//than reallocated. Spilled meshes are uploaded in chunks, releasing the mapped pages after each one so the
+//resident memory stays bounded while the data is copied to the GPU. Returns false if the spilled data couldn't be mapped again
+static bool UploadBufferData(GLenum a_target, size_t a_bytes, const void* a_data, OBJMesh* a_spilledMesh)
+{
+	GLint64 currentSize = 0;
+	glGetBufferParameteri64v(a_target, GL_BUFFER_SIZE, &currentSize);
+	if ((size_t)currentSize != a_bytes)
+	{
+		if (a_spilledMesh == nullptr)
+		{
+			glBufferData(a_target, a_bytes, a_data, GL_STATIC_DRAW);
+			return true;
+		}
+		glBufferData(a_target, a_bytes, nullptr, GL_STATIC_DRAW);
+	}
+
+	const size_t chunkBytes = (a_spilledMesh != nullptr) ? 16 * 1024 * 1024 : a_bytes;
+	for (size_t offset = 0; offset < a_bytes; offset += chunkBytes)
+	{
+		size_t bytes = (a_bytes - offset < chunkBytes) ? a_bytes - offset : chunkBytes;
+		glBufferSubData(a_target, offset, bytes, (const char*)a_data + offset);
+		if (a_spilledMesh != nullptr && !a_spilledMesh->trim())
+		{
+			std::cout << "Unable to map spilled mesh data: " << a_spilledMesh->m_name << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+//upload the positions of a mesh's vertices, packed without the rest of the vertex, to the buffer bound to GL_ARRAY_BUFFER
+//they are packed a chunk at a time so only one chunk is ever held on the CPU, a spilled mesh releases its mapped
+//pages after each chunk. Returns false if the spilled data couldn't be mapped again
+static bool UploadPositionData(OBJMesh* a_mesh, OBJMesh* a_spilledMesh)
+{
+	const size_t vertexCount = a_mesh->getVertexCount();
+	const size_t bytes = vertexCount * sizeof(glm::vec3);
+	GLint64 currentSize = 0;
+	glGetBufferParameteri64v(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &currentSize);
+	if ((size_t)currentSize != bytes)
+	{
+		glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+	}
+
+	const size_t chunkVertices = (16 * 1024 * 1024) / sizeof(glm::vec3);
+	std::vector<glm::vec3> positions((vertexCount < chunkVertices) ? vertexCount : chunkVertices);
+	for (size_t first = 0; first < vertexCount; first += chunkVertices)
+	{
+		size_t count = (vertexCount - first < chunkVertices) ? vertexCount - first : chunkVertices;
+		//trimming may map the data again, so the vertices are fetched for every chunk
+		const OBJVertex* vertices = a_mesh->getVertexData() + first;
+		for (size_t i = 0; i < count; ++i)
+		{
+			positions[i] = glm::vec3(vertices[i].position);
+		}
+		glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::vec3), count * sizeof(glm::vec3), positions.data());
+		if (a_spilledMesh != nullptr && !a_spilledMesh->trim())
+		{
+			std::cout << "Unable to map spilled mesh data: " << a_spilledMesh->m_name << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void ObjectRenderer::UploadModel(OBJModel* _model, std::string _owner)
+{
+	//upload the data for each mesh once and account for the CPU and GPU memory it uses
+	for (unsigned int i = 0; i < _model->getMeshCount(); ++i)
+	{
+		OBJMesh* pMesh = _model->getMeshByIndex(i);
+		UploadMesh(pMesh);
+		if (m_multiDrawEnabled)
+		{
+			m_meshPool->AddMesh(pMesh);
+		}
+
+		MemoryTracker::Allocate(MemoryTracker::BufferData, _owner, pMesh->getVertexCount() * (sizeof(OBJVertex) + sizeof(glm::vec3)) + pMesh->getIndexCount() * pMesh->getIndexSize());
+		MemoryTracker::Allocate(MemoryTracker::MeshData, _owner, pMesh->getMemoryUsage());
+	}
+	UploadMaterials(_model, _owner);
+}
+
+void ObjectRenderer::UploadMaterials(OBJModel* _model, std::string _owner)
+{
+	if (_model->GetMaterialCount() == 0) { return; }
+
+	//each material is padded to the uniform buffer offset alignment so its range can be bound on its own
+	size_t stride = m_frameUniforms->GetAlignedSize(sizeof(MaterialUniforms));
+	std::vector<unsigned char> table(stride * _model->GetMaterialCount(), 0);
+	for (unsigned int i = 0; i < _model->GetMaterialCount(); ++i)
+	{
+		OBJMaterial* mat = _model->getMaterialByIndex(i);
+		MaterialUniforms* pUniforms = (MaterialUniforms*)(table.data() + stride * i);
+		pUniforms->kA = mat->kA;
+		pUniforms->kD = mat->kD;
+		pUniforms->kS = mat->kS;
+		mat->uniformOffset = (unsigned int)(stride * i);
+	}
+
+	//the colours don't change after loading, so the table is uploaded once into immutable storage
+	unsigned int bufferID = 0;
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+	glBufferStorage(GL_UNIFORM_BUFFER, table.size(), table.data(), 0);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	for (unsigned int i = 0; i < _model->GetMaterialCount(); ++i)
+	{
+		_model->getMaterialByIndex(i)->uniformBufferID = bufferID;
+	}
+	MemoryTracker::Allocate(MemoryTracker::BufferData, _owner, table.size());
+}
+
+void ObjectRenderer::UploadMesh(OBJMesh* _mesh)
+{
+	//work out the data texture streaming needs while the vertices are still resident
+	_mesh->m_uvDensity = _mesh->calculateUVDensity();
+	//the box is found once, the sphere is centred on it so only its radius needs another pass over the vertices
+	glm::vec3 boundsMin, boundsMax;
+	_mesh->calculateBoundingBox(boundsMin, boundsMax);
+	_mesh->m_boundsExtents = (boundsMax - boundsMin) * 0.5f;
+	_mesh->calculateBoundingSphere(boundsMin, boundsMax, _mesh->m_boundsCentre, _mesh->m_boundsRadius);
+	_mesh->calculateOccluder(_mesh->m_occluderTriangles, s_maxOccluderTriangles);
+
+	//a mesh that already has buffers (handed over from the previous version of a reloaded model) reuses them
+	bool createBuffers = (_mesh->m_vertexArrayID == 0);
+	if (createBuffers)
+	{
+		glGenVertexArrays(1, &_mesh->m_vertexArrayID);
+		glGenBuffers(1, &_mesh->m_vertexBufferID);
+		glGenBuffers(1, &_mesh->m_indexBufferID);
+	}
+
+	glBindVertexArray(_mesh->m_vertexArrayID);
+	glBindBuffer(GL_ARRAY_BUFFER, _mesh->m_vertexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _mesh->m_indexBufferID);
+
+	OBJMesh* pSpilledMesh = _mesh->isSpilled() ? _mesh : nullptr;
+	//the index data is only read if the vertex data could be, a spilled mesh that lost its mapping has nothing left to read
+	bool uploaded = UploadBufferData(GL_ARRAY_BUFFER, _mesh->getVertexCount() * sizeof(OBJVertex), _mesh->getVertexData(), pSpilledMesh);
+	if (uploaded)
+	{
+		uploaded = UploadBufferData(GL_ELEMENT_ARRAY_BUFFER, _mesh->getIndexCount() * _mesh->getIndexSize(), _mesh->getIndexData(), pSpilledMesh);
+	}
+
+	if (createBuffers)
+	{
+		glEnableVertexAttribArray(0); //position
+		glEnableVertexAttribArray(1); //normal
+		glEnableVertexAttribArray(2); //uv coord
+
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(OBJVertex), ((char*)0) + OBJVertex::PositionOffset);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_TRUE, sizeof(OBJVertex), ((char*)0) + OBJVertex::NormalOffset);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_TRUE, sizeof(OBJVertex), ((char*)0) + OBJVertex::UVCoordOffset);
+
+		SetupInstanceAttributes();
+	}
+
+	//the depth prepass only needs positions, a packed copy of them is read through a second vertex array that
+	//shares the mesh's index buffer so the prepass fetches a fraction of the vertex data the main pass does
+	bool createDepthBuffers = (_mesh->m_depthVertexArrayID == 0);
+	if (createDepthBuffers)
+	{
+		glGenVertexArrays(1, &_mesh->m_depthVertexArrayID);
+		glGenBuffers(1, &_mesh->m_positionBufferID);
+	}
+	glBindVertexArray(_mesh->m_depthVertexArrayID);
+	glBindBuffer(GL_ARRAY_BUFFER, _mesh->m_positionBufferID);
+	if (uploaded)
+	{
+		UploadPositionData(_mesh, pSpilledMesh);
+	}
+	if (createDepthBuffers)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _mesh->m_indexBufferID);
+		glEnableVertexAttribArray(0); //position
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+
+		SetupInstanceAttributes();
+	}
+
+	//unbind the vertex array first so the element buffer binding stays recorded in it
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void ObjectRenderer::UpdateActorMatrices()
+{
+	//one pass in actor order, so the cached matrices that change are written one after another
+	for (size_t index = 0; index < m_actorMatrixDirty.size(); ++index)
+	{
+		if (!m_actorMatrixDirty[index]) { continue; }
+
+		//use a mat4 to set position, rotation and scale
+		glm::mat4 trans = glm::mat4(1.0f);
+
+		//apply translation for the objects position
+		trans = glm::translate(trans, glm::vec3(m_actorPosition[index][0], m_actorPosition[index][2], m_actorPosition[index][1])); //switch around Y and Z axis to be correct
+
+		//apply rotation for each axis
+		trans = glm::rotate(trans, glm::radians(m_actorRotation[index][0]), glm::vec3(1.0, 0.0, 0.0));
+		trans = glm::rotate(trans, glm::radians(m_actorRotation[index][1]), glm::vec3(0.0, 1.0, 0.0));
+		trans = glm::rotate(trans, glm::radians(m_actorRotation[index][2]), glm::vec3(0.0, 0.0, 1.0));
+
+		//apply the scale factor, then place the model within the actor
+		trans = glm::scale(trans, glm::vec3(m_actorScale[index]));
+		if (m_actorModels[index] != nullptr)
+		{
+			trans = trans * m_actorModels[index]->getWorldMatrix();
+		}
+
+		m_actorWorldMatrix[index] = trans;
+		m_actorMatrixDirty[index] = false;
+	}
+}
+
+void ObjectRenderer::UpdateDepthPrepass()
+{
+	//the oldest query is read once the GPU has finished with it, checking it is available first avoids a stall
+	unsigned int query = m_overdrawQueries[m_overdrawQueryIndex];
+	if (!m_overdrawQueryPending[m_overdrawQueryIndex]) { return; }
+	GLuint available = 0;
+	glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == 0) { return; }
+	GLuint samplesPassed = 0;
+	glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samplesPassed);
+	m_overdrawQueryPending[m_overdrawQueryIndex] = false;
+
+	//multisampled framebuffers count every sample, overdraw is the fragments shaded for each pixel of the screen
+	GLint samples = 0;
+	glGetIntegerv(GL_SAMPLES, &samples);
+	float pixels = (float)m_windowWidth * (float)m_windowHeight;
+	if (pixels <= 0.0f) { return; }
+	m_overdraw = (float)samplesPassed / (pixels * (float)std::max(samples, 1));
+
+	//the prepass saves shading the fragments that were covered later and costs drawing the triangles again
+	float saved = (m_overdraw - 1.0f) * pixels;
+	float cost = (float)m_prepassTriangles * s_prepassTriangleCost;
+	if (!m_depthPrepassAuto && saved > cost * s_prepassMargin)
+	{
+		m_depthPrepassAuto = true;
+	}
+	else if (m_depthPrepassAuto && saved * s_prepassMargin < cost)
+	{
+		m_depthPrepassAuto = false;
+	}
+}
+
+void ObjectRenderer::SetupInstanceAttributes()
+{
+	//the transform of each instance is a mat4 taking four attribute locations, the buffer it comes from is bound
+	//when the mesh is drawn as it holds a different range for every model each frame
+	for (unsigned int column = 0; column < 4; ++column)
+	{
+		glEnableVertexAttribArray(s_instanceTransformLocation + column);
+		glVertexAttribFormat(s_instanceTransformLocation + column, 4, GL_FLOAT, GL_FALSE, column * sizeof(glm::vec4));
+		glVertexAttribBinding(s_instanceTransformLocation + column, s_instanceBinding);
+	}
+	glVertexBindingDivisor(s_instanceBinding, 1);
+}
+
+void ObjectRenderer::UnloadModel(OBJModel* _model, std::string _owner)
+{
+	for (unsigned int i = 0; i < _model->getMeshCount(); ++i)
+	{
+		OBJMesh* pMesh = _model->getMeshByIndex(i);
+		MemoryTracker::Free(MemoryTracker::BufferData, _owner, pMesh->getVertexCount() * (sizeof(OBJVertex) + sizeof(glm::vec3)) + pMesh->getIndexCount() * pMesh->getIndexSize());
+		MemoryTracker::Free(MemoryTracker::MeshData, _owner, pMesh->getMemoryUsage());
+
+		m_meshPool->RemoveMesh(pMesh);
+		glDeleteVertexArrays(1, &pMesh->m_vertexArrayID);
+		glDeleteBuffers(1, &pMesh->m_vertexBufferID);
+		glDeleteBuffers(1, &pMesh->m_indexBufferID);
+		glDeleteVertexArrays(1, &pMesh->m_depthVertexArrayID);
+		glDeleteBuffers(1, &pMesh->m_positionBufferID);
+		pMesh->m_vertexArrayID = pMesh->m_vertexBufferID = pMesh->m_indexBufferID = 0;
+		pMesh->m_depthVertexArrayID = pMesh->m_positionBufferID = 0;
+	}
+	for (unsigned int i = 0; i < _model->GetMaterialCount(); ++i)
+	{
+		MemoryTracker::Free(MemoryTracker::MaterialData, _owner, _model->getMaterialByIndex(i)->getMemoryUsage());
+	}
+	//every material shares the model's material table
+	if (_model->GetMaterialCount() > 0 && _model->getMaterialByIndex(0)->uniformBufferID != 0)
+	{
+		unsigned int bufferID = _model->getMaterialByIndex(0)->uniformBufferID;
+		MemoryTracker::Free(MemoryTracker::BufferData, _owner, m_frameUniforms->GetAlignedSize(sizeof(MaterialUniforms)) * _model->GetMaterialCount());
+		glDeleteBuffers(1, &bufferID);
+		for (unsigned int i = 0; i < _model->GetMaterialCount(); ++i)
+		{
+			_model->getMaterialByIndex(i)->uniformBufferID = 0;
+		}
+	}
+}
+
+void ObjectRenderer::UpdateMeshPool()
+{
+	if (!m_multiDrawEnabled)
+	{
+		m_meshPool->Clear();
+		return;
+	}
+	for (auto iter = m_loadedModels.begin(); iter != m_loadedModels.end(); ++iter)
+	{
+		for (unsigned int i = 0; i < iter->first->getMeshCount(); ++i)
+		{
+			m_meshPool->AddMesh(iter->first->getMeshByIndex(i));
+		}
+	}
+}
+
+void ObjectRenderer::LoadModelMaterials(OBJModel* _model, std::string _owner)
+{
+	TextureManager* pTM = TextureManager::GetInstance();
+	//load in texture for model if any are present
+	for (unsigned int i = 0; i < _model->GetMaterialCount(); ++i)
+	{
+		OBJMaterial* mat = _model->getMaterialByIndex(i);
+		MemoryTracker::Allocate(MemoryTracker::MaterialData, _owner, mat->getMemoryUsage());
+		for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+		{
+			if (mat->textureFileNames[n].size() > 0)
+			{
+				//the texture type decides which compressed format the texture is stored in
+				TextureCompressor::Usage usage = (n == OBJMaterial::TextureTypes::SpecularTexture) ? TextureCompressor::SpecularMap :
+					(n == OBJMaterial::TextureTypes::NormalTexture) ? TextureCompressor::NormalMap : TextureCompressor::ColourMap;
+				unsigned int textureID = pTM->LoadTexture(mat->textureFileNames[n].c_str(), _owner.c_str(), usage);
+				mat->textureIDs[n] = textureID;
+			}
+		}
+	}
+}
+
+void ObjectRenderer::ReleaseModelTextures(OBJModel* _model)
+{
+	TextureManager* pTM = TextureManager::GetInstance();
+	for (unsigned int i = 0; i < _model->GetMaterialCount(); ++i)
+	{
+		OBJMaterial* mat = _model->getMaterialByIndex(i);
+		for (int n = 0; n < OBJMaterial::TextureTypes::TextureTypes_Count; ++n)
+		{
+			if (mat->textureIDs[n] != 0)
+			{
+				pTM->ReleaseTexture(mat->textureIDs[n]);
+				mat->textureIDs[n] = 0;
+			}
+		}
+	}
+}
+
+void ObjectRenderer::ReloadModel(OBJModel* _model, std::string _filename)
+{
+	//load a fresh copy with the same settings, the current model stays in use if this fails
+	OBJModel* pFresh = new OBJModel();
+	pFresh->setOutOfCore(_model->isOutOfCore(), _model->getMemoryCap(), _model->getScratchDirectory());
+	pFresh->setSplitMeshes(_model->isSplittingMeshes());
+	pFresh->setGeometryCache(_model->isUsingGeometryCache());
+	if (!pFresh->load(_filename.c_str()))
+	{
+		std::cout << "Failed to reload model: " << _filename << std::endl;
+		delete pFresh;
+		return;
 	}
+
+	//hand the GPU buffers of the old meshes over to the new ones so they are updated rather than recreated
+	unsigned int sharedMeshes = (pFresh->getMeshCount() < _model->getMeshCount()) ? pFresh->getMeshCount() : _model->getMeshCount();
+	for (unsigned int i = 0; i < sharedMeshes; ++i)
+	{
+		OBJMesh* pOld = _model->getMeshByIndex(i);
+		OBJMesh* pNew = pFresh->getMeshByIndex(i);
+		std::swap(pOld->m_vertexArrayID, pNew->m_vertexArrayID);
+		std::swap(pOld->m_vertexBufferID, pNew->m_vertexBufferID);
+		std::swap(pOld->m_indexBufferID, pNew->m_indexBufferID);
+		std::swap(pOld->m_depthVertexArrayID, pNew->m_depthVertexArrayID);
+		std::swap(pOld->m_positionBufferID, pNew->m_positionBufferID);
+	}
+
+	//load the new textures before releasing the old ones so textures used by both aren't reloaded from disk
+	LoadModelMaterials(pFresh, _filename);
+	ReleaseModelTextures(_model);
+	//free the accounting for the old data and any buffers of meshes that no longer exist
+	UnloadModel(_model, _filename);
+	UploadModel(pFresh, _filename);
+
+	//swap the new data into the existing model so the actors that reference it see the change
+	_model->swap(*pFresh);
+	delete pFresh;
+	//the reloaded model can be placed differently within its actors
+	for (size_t i = 0; i < m_actorModels.size(); ++i)
+	{
+		if (m_actorModels[i] == _model)
+		{
+			m_actorMatrixDirty[i] = true;
+		}
+	}
+	std::cout << "Reloaded model: " << _filename << std::endl;
 }
 
 void ObjectRenderer::UpdateGUI()
@@ -516,6 +1474,7 @@ void ObjectRenderer::UpdateGUI()
 		if (ImGui::CollapsingHeader("GUI"))
 		{
 			ImGui::Checkbox("Show frame data", &m_frameDataEnabled);
+			ImGui::Checkbox("Show memory usage", &m_memoryPanelEnabled);
 
 			ImGui::Text("Reset to default settings");
 			if (ImGui::Button("Reset", ImVec2(70, 20)))
@@ -535,6 +1494,48 @@ void ObjectRenderer::UpdateGUI()
 		{
 			ImGui::Checkbox("Draw Grid Lines", &m_gridLinesEnabled);
 		}
+
+		if (ImGui::CollapsingHeader("Textures"))
+		{
+			//streaming keeps only the mip levels that are visible on screen resident
+			ImGui::Checkbox("Stream texture mips", &m_textureStreamingEnabled);
+			ImGui::InputInt("Upload budget (KB/frame)", &m_textureStreamingBudgetKB);
+			m_textureStreamingBudgetKB = (m_textureStreamingBudgetKB < 64) ? 64 : m_textureStreamingBudgetKB;
+			//texture arrays let materials with same sized textures be drawn without rebinding them
+			ImGui::Checkbox("Texture arrays", &m_textureArraysEnabled);
+			//unreferenced textures are kept for reuse until the textures use more than the budget, 0 keeps them all
+			ImGui::InputInt("Memory budget (MB)", &m_textureMemoryBudgetMB);
+			m_textureMemoryBudgetMB = (m_textureMemoryBudgetMB < 0) ? 0 : m_textureMemoryBudgetMB;
+			TextureManager::TextureStats stats = TextureManager::GetInstance()->GetStats();
+			ImGui::Text("Texture memory: %s", MemoryTracker::FormatBytes(stats.memoryUsage).c_str());
+			ImGui::Text("Textures: %u (%u unused)", stats.textureCount, stats.cachedCount);
+			ImGui::Text("Hits: %u  Misses: %u  Evictions: %u", stats.hits, stats.misses, stats.evictions);
+			ImGui::Text("Identical files shared: %u", stats.sharedFiles);
+			ImGui::Text("Textures loading: %u", TextureManager::GetInstance()->GetPendingLoadCount());
+		}
+
+		if (ImGui::CollapsingHeader("Rendering"))
+		{
+			//multi-draw submits every pooled mesh that uses the same texture arrays with one call, it needs texture arrays
+			if (ImGui::Checkbox("Multi-draw indirect", &m_multiDrawEnabled))
+			{
+				UpdateMeshPool();
+			}
+			if (m_objMultiDrawProgram == nullptr && m_objProgram != nullptr)
+			{
+				ImGui::Text("Multi-draw isn't supported by this driver");
+			}
+			ImGui::Text("Pooled meshes: %u (%s)", m_meshPool->GetMeshCount(), MemoryTracker::FormatBytes(m_meshPool->GetMemoryUsage()).c_str());
+			ImGui::Checkbox("Frustum culling", &m_frustumCullingEnabled);
+			ImGui::Checkbox("Occlusion culling", &m_occlusionCullingEnabled);
+			//automatic turns the prepass on when the overdraw it would save outweighs drawing the triangles twice
+			ImGui::Combo("Depth prepass", &m_depthPrepassMode, "Off\0On\0Automatic\0");
+		}
+		TextureManager* pTM = TextureManager::GetInstance();
+		pTM->SetStreamingEnabled(m_textureStreamingEnabled);
+		pTM->SetStreamingBudget((size_t)m_textureStreamingBudgetKB * 1024);
+		pTM->SetTextureArraysEnabled(m_textureArraysEnabled);
+		pTM->SetMemoryBudget((size_t)m_textureMemoryBudgetMB * 1024 * 1024);
 	}
 	m_settingsPanel.expanded = ImGui::IsWindowCollapsed() ? false : true;
 
@@ -556,6 +1557,20 @@ void ObjectRenderer::UpdateGUI()
 		{
 			m_fileDialog.Open();
 		}
+
+		//out-of-core loading keeps large OBJ files on disk while they are imported
+		ImGui::Checkbox("Out-of-core import", &m_outOfCoreEnabled);
+		if (m_outOfCoreEnabled)
+		{
+			ImGui::InputInt("Memory cap (MB)", &m_outOfCoreMemoryCapMB);
+			m_outOfCoreMemoryCapMB = (m_outOfCoreMemoryCapMB < 16) ? 16 : m_outOfCoreMemoryCapMB;
+		}
+		//splitting large meshes lets every mesh be drawn with 16 bit indices at the cost of extra draw calls
+		ImGui::Checkbox("Split meshes for 16-bit indices", &m_splitMeshesEnabled);
+		//the geometry cache stores a compressed copy of the parsed meshes next to the OBJ file for faster reloads
+		ImGui::Checkbox("Cache compressed geometry", &m_geometryCacheEnabled);
+		//textures are compressed to BCn formats on first load and cached next to the image as a .texcache file
+		ImGui::Checkbox("Compress textures", &m_textureCompressionEnabled);
 		
 		m_fileDialog.Display();
 		
@@ -675,6 +1690,8 @@ void ObjectRenderer::UpdateGUI()
 					m_actorPosition.push_back({ 0.0f, 0.0f, 0.0f });
 					m_actorRotation.push_back({ 0.0f, 0.0f, 0.0f });
 					m_actorScale.push_back(1.0f);
+					m_actorWorldMatrix.push_back(glm::mat4(1.0f));
+					m_actorMatrixDirty.push_back(true);
 
 					std::vector<std::string> currentActors = m_actors;
 
@@ -718,6 +1735,8 @@ void ObjectRenderer::UpdateGUI()
 						m_actorPosition.erase(m_actorPosition.begin() + index);
 						m_actorRotation.erase(m_actorRotation.begin() + index);
 						m_actorScale.erase(m_actorScale.begin() + index);
+						m_actorWorldMatrix.erase(m_actorWorldMatrix.begin() + index);
+						m_actorMatrixDirty.erase(m_actorMatrixDirty.begin() + index);
 						m_selectedActor = "";
 					}
 				}
@@ -736,6 +1755,7 @@ void ObjectRenderer::UpdateGUI()
 						if (m_actorPosition[index] != vec3newValuesPosition)
 						{
 							m_actorPosition.at(index) = vec3newValuesPosition;
+							m_actorMatrixDirty[index] = true;
 						}
 					}
 
@@ -748,6 +1768,7 @@ void ObjectRenderer::UpdateGUI()
 						if (m_actorRotation[index] != vec3newValuesRotation)
 						{
 							m_actorRotation.at(index) = vec3newValuesRotation;
+							m_actorMatrixDirty[index] = true;
 						}
 					}
 
@@ -793,6 +1814,7 @@ void ObjectRenderer::UpdateGUI()
 						if (m_actorScale[index] != inputValueScale)
 						{
 							m_actorScale.at(index) = inputValueScale;
+							m_actorMatrixDirty[index] = true;
 						}
 					}
 				}
@@ -807,6 +1829,9 @@ void ObjectRenderer::UpdateGUI()
 
 #pragma region Frame Data
 
+	//the memory panel sits to the right of the frame data panel when it is shown
+	ImVec2 memoryPanelPos = ImVec2(windowSize.x + 10.0f, 10.0f);
+
 	if (m_frameDataEnabled)
 	{
 		const float distance = 10.0f;
@@ -825,6 +1850,10 @@ void ObjectRenderer::UpdateGUI()
 		{
 			ImGui::Separator();
 			ImGui::Text("Application Average:   \n FPS : %0.1f \n %0.3f ms/frame", io.Framerate, 1000.0f / io.Framerate);
+			ImGui::Text("Mesh draw calls: %u (%u multi-drawn)", m_meshDrawCalls, m_indirectDraws);
+			ImGui::Text("Frustum culled: %u of %u meshes (%0.3f ms)", m_culledMeshes, m_testedMeshes, m_cullTime);
+			ImGui::Text("Occlusion culled: %u meshes by %u occluders (%0.3f ms)", m_occludedMeshes, m_occluderCount, m_occlusionTime);
+			ImGui::Text("Depth prepass: %s (overdraw %0.2fx, %u triangles)", m_depthPrepassActive ? "on" : "off", m_overdraw, m_prepassTriangles);
 
 			if (ImGui::IsMousePosValid())
 			{
@@ -834,6 +1863,54 @@ void ObjectRenderer::UpdateGUI()
 			{
 				ImGui::Text("Mouse Position: \n <Not active in window>");
 			}
+			memoryPanelPos.x += ImGui::GetWindowSize().x + 10.0f;
+		}
+
+		ImGui::End();
+	}
+
+#pragma endregion
+
+#pragma region Memory Panel
+
+	MemoryTracker* pMemory = MemoryTracker::GetInstance();
+	if (m_memoryPanelEnabled && pMemory != nullptr)
+	{
+		ImGui::SetNextWindowPos(memoryPanelPos, ImGuiCond_Always);
+		ImGui::SetNextWindowBgAlpha(0.3f);
+
+		if (ImGui::Begin("Memory Usage", &m_memoryPanelEnabled, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize |
+			ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav))
+		{
+			ImGui::Text("CPU Total: %s", MemoryTracker::FormatBytes(pMemory->GetCPUTotal()).c_str());
+			ImGui::Text("GPU Total: %s", MemoryTracker::FormatBytes(pMemory->GetGPUTotal()).c_str());
+			ImGui::Separator();
+
+			//break down by category
+			for (int i = 0; i < MemoryTracker::Category_Count; ++i)
+			{
+				MemoryTracker::Category category = (MemoryTracker::Category)i;
+				ImGui::Text("%s %s: %s", MemoryTracker::IsGPUCategory(category) ? "[GPU]" : "[CPU]",
+					MemoryTracker::GetCategoryName(category), MemoryTracker::FormatBytes(pMemory->GetCategoryTotal(category)).c_str());
+			}
+			ImGui::Separator();
+
+			//break down by model, each model can be expanded to show its categories
+			for (auto& owner : pMemory->GetOwners())
+			{
+				std::string label = owner.first + " - " + MemoryTracker::FormatBytes(pMemory->GetOwnerTotal(owner.first));
+				if (ImGui::TreeNode(label.c_str()))
+				{
+					for (int i = 0; i < MemoryTracker::Category_Count; ++i)
+					{
+						if (owner.second.bytes[i] > 0)
+						{
+							ImGui::Text("%s: %s", MemoryTracker::GetCategoryName((MemoryTracker::Category)i), MemoryTracker::FormatBytes(owner.second.bytes[i]).c_str());
+						}
+					}
+					ImGui::TreePop();
+				}
+			}
 		}
 
 		ImGui::End();
@@ -884,7 +1961,21 @@ void ObjectRenderer::SetupGUI()
 
 	m_skyboxEnabled = true;
 	m_frameDataEnabled = false;
+	m_memoryPanelEnabled = false;
 	m_gridLinesEnabled = true;
+	m_outOfCoreEnabled = false;
+	m_outOfCoreMemoryCapMB = 256;
+	m_splitMeshesEnabled = false;
+	m_geometryCacheEnabled = false;
+	m_textureCompressionEnabled = true;
+	m_textureStreamingEnabled = true;
+	m_textureStreamingBudgetKB = 4096;
+	m_textureArraysEnabled = true;
+	m_multiDrawEnabled = false;
+	m_frustumCullingEnabled = true;
+	m_occlusionCullingEnabled = true;
+	m_depthPrepassMode = PrepassAuto;
+	m_textureMemoryBudgetMB = 256;
 
 	m_backgroundColour = glm::vec3(0.45f, 0.8f, 1.0f);
 }
\ No newline at end of file
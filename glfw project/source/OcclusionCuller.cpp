@@ -0,0 +1,277 @@
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE2
+#endif
+
+//pixels covered by one entry of the tile level, in both directions
+static const unsigned int s_tileSize = 8;
+//rows rasterized by one job, a whole number of tiles so each job can build its own part of the tile level
+static const unsigned int s_bandHeight = 16;
+//vertices closer to the eye than this are treated as crossing the near plane
+static const float s_minW = 1e-4f;
+
+OcclusionCuller::OcclusionCuller(unsigned int a_width, unsigned int a_height) : m_projectionView(1.0f), m_triangles(), m_depth(), m_tileDepth()
+{
+	m_width = std::max((a_width + s_tileSize - 1) / s_tileSize, 1u) * s_tileSize;
+	m_height = std::max((a_height + s_bandHeight - 1) / s_bandHeight, 1u) * s_bandHeight;
+	m_tilesWide = m_width / s_tileSize;
+	m_tilesHigh = m_height / s_tileSize;
+	m_depth.resize((size_t)m_width * m_height, 1.0f);
+	m_tileDepth.resize((size_t)m_tilesWide * m_tilesHigh, 1.0f);
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& a_projectionView)
+{
+	m_projectionView = a_projectionView;
+	m_triangles.clear();
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	std::fill(m_tileDepth.begin(), m_tileDepth.end(), 1.0f);
+}
+
+void OcclusionCuller::AddOccluder(const std::vector<glm::vec3>& a_triangles, const glm::mat4& a_transform)
+{
+	glm::mat4 matrix = m_projectionView * a_transform;
+	for (size_t i = 0; i + 2 < a_triangles.size(); i += 3)
+	{
+		ScreenTriangle triangle;
+		bool clipped = false;
+		for (int j = 0; j < 3 && !clipped; ++j)
+		{
+			glm::vec4 clip = matrix * glm::vec4(a_triangles[i + j], 1.0f);
+			clipped = (clip.w < s_minW);
+			//pixel coordinates and a depth from 0 to 1, in the same orientation as the GL viewport
+			float inverseW = 1.0f / clip.w;
+			triangle.x[j] = (clip.x * inverseW * 0.5f + 0.5f) * m_width;
+			triangle.y[j] = (clip.y * inverseW * 0.5f + 0.5f) * m_height;
+			triangle.z[j] = clip.z * inverseW * 0.5f + 0.5f;
+		}
+		if (clipped) { continue; }
+		triangle.minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+		triangle.maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+		float minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+		float maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+		float minZ = std::min(triangle.z[0], std::min(triangle.z[1], triangle.z[2]));
+		//skip triangles that are off screen or beyond the far plane
+		if (triangle.maxY < 0.0f || triangle.minY > (float)m_height || maxX < 0.0f || minX > (float)m_width || minZ > 1.0f) { continue; }
+		m_triangles.push_back(triangle);
+	}
+}
+
+void OcclusionCuller::Rasterize()
+{
+	//each band only writes its own rows and tiles so the bands don't need to share anything
+	unsigned int bandCount = m_height / s_bandHeight;
+	ThreadPool* pPool = ThreadPool::GetInstance();
+	if (pPool != nullptr && !m_triangles.empty())
+	{
+		pPool->ParallelFor(bandCount, [this](unsigned int a_band) { RasterizeBand(a_band); });
+	}
+	else
+	{
+		for (unsigned int band = 0; band < bandCount && !m_triangles.empty(); ++band)
+		{
+			RasterizeBand(band);
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeBand(unsigned int a_band)
+{
+	unsigned int minRow = a_band * s_bandHeight, maxRow = minRow + s_bandHeight - 1;
+	for (auto iter = m_triangles.begin(); iter != m_triangles.end(); ++iter)
+	{
+		if (iter->maxY >= (float)minRow && iter->minY <= (float)(maxRow + 1))
+		{
+			RasterizeTriangle(*iter, minRow, maxRow);
+		}
+	}
+
+	//the tile level keeps the farthest depth in each tile, so a box nearer than it is in front of the whole tile
+	for (unsigned int tileY = minRow / s_tileSize; tileY <= maxRow / s_tileSize; ++tileY)
+	{
+		for (unsigned int tileX = 0; tileX < m_tilesWide; ++tileX)
+		{
+			float farthest = 0.0f;
+			for (unsigned int y = 0; y < s_tileSize; ++y)
+			{
+				const float* row = &m_depth[(size_t)(tileY * s_tileSize + y) * m_width + tileX * s_tileSize];
+				for (unsigned int x = 0; x < s_tileSize; ++x)
+				{
+					farthest = std::max(farthest, row[x]);
+				}
+			}
+			m_tileDepth[(size_t)tileY * m_tilesWide + tileX] = farthest;
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& a_triangle, unsigned int a_minRow, unsigned int a_maxRow)
+{
+	//wind the triangle so the edge functions are positive inside it, the culler draws both sides of every triangle
+	float x0 = a_triangle.x[0], y0 = a_triangle.y[0], z0 = a_triangle.z[0];
+	float x1 = a_triangle.x[1], y1 = a_triangle.y[1], z1 = a_triangle.z[1];
+	float x2 = a_triangle.x[2], y2 = a_triangle.y[2], z2 = a_triangle.z[2];
+	float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+	if (fabsf(area) < 1e-6f) { return; }
+	if (area < 0.0f)
+	{
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+		std::swap(z1, z2);
+		area = -area;
+	}
+
+	//edge functions and the depth plane as a * x + b * y + c, evaluated at pixel centres
+	float edgeA[3] = { y1 - y2, y2 - y0, y0 - y1 };
+	float edgeB[3] = { x2 - x1, x0 - x2, x1 - x0 };
+	float edgeC[3] = { x1 * y2 - x2 * y1, x2 * y0 - x0 * y2, x0 * y1 - x1 * y0 };
+	float inverseArea = 1.0f / area;
+	float depthA = (edgeA[0] * z0 + edgeA[1] * z1 + edgeA[2] * z2) * inverseArea;
+	float depthB = (edgeB[0] * z0 + edgeB[1] * z1 + edgeB[2] * z2) * inverseArea;
+	float depthC = (edgeC[0] * z0 + edgeC[1] * z1 + edgeC[2] * z2) * inverseArea;
+
+	float minX = std::min(x0, std::min(x1, x2)), maxX = std::max(x0, std::max(x1, x2));
+	float minY = std::min(y0, std::min(y1, y2)), maxY = std::max(y0, std::max(y1, y2));
+	int startX = std::max((int)floorf(minX), 0), endX = std::min((int)ceilf(maxX), (int)m_width - 1);
+	int startY = std::max((int)floorf(minY), (int)a_minRow), endY = std::min((int)ceilf(maxY), (int)a_maxRow);
+	if (startX > endX || startY > endY) { return; }
+
+#ifdef OCCLUSION_CULLER_SSE2
+	//four pixels of a row at a time, the rows are a multiple of four pixels wide so the first pixel is rounded down
+	startX &= ~3;
+	const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 stepA[3], rowA[3];
+	for (int e = 0; e < 3; ++e)
+	{
+		stepA[e] = _mm_set1_ps(edgeA[e] * 4.0f);
+		rowA[e] = _mm_mul_ps(_mm_set1_ps(edgeA[e]), _mm_add_ps(_mm_set1_ps((float)startX), laneOffsets));
+	}
+	__m128 depthStep = _mm_set1_ps(depthA * 4.0f);
+	__m128 depthRow = _mm_mul_ps(_mm_set1_ps(depthA), _mm_add_ps(_mm_set1_ps((float)startX), laneOffsets));
+	for (int y = startY; y <= endY; ++y)
+	{
+		float centreY = (float)y + 0.5f;
+		__m128 edge[3];
+		for (int e = 0; e < 3; ++e)
+		{
+			edge[e] = _mm_add_ps(rowA[e], _mm_set1_ps(edgeB[e] * centreY + edgeC[e]));
+		}
+		__m128 depth = _mm_add_ps(depthRow, _mm_set1_ps(depthB * centreY + depthC));
+		float* row = &m_depth[(size_t)y * m_width];
+		for (int x = startX; x <= endX; x += 4)
+		{
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)), _mm_cmpge_ps(edge[2], zero));
+			if (_mm_movemask_ps(inside) != 0)
+			{
+				__m128 current = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(current, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+			}
+			for (int e = 0; e < 3; ++e)
+			{
+				edge[e] = _mm_add_ps(edge[e], stepA[e]);
+			}
+			depth = _mm_add_ps(depth, depthStep);
+		}
+	}
+#else
+	for (int y = startY; y <= endY; ++y)
+	{
+		float centreY = (float)y + 0.5f;
+		float* row = &m_depth[(size_t)y * m_width];
+		for (int x = startX; x <= endX; ++x)
+		{
+			float centreX = (float)x + 0.5f;
+			bool inside = true;
+			for (int e = 0; e < 3 && inside; ++e)
+			{
+				inside = (edgeA[e] * centreX + edgeB[e] * centreY + edgeC[e] >= 0.0f);
+			}
+			if (inside)
+			{
+				row[x] = std::min(row[x], depthA * centreX + depthB * centreY + depthC);
+			}
+		}
+	}
+#endif
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3& a_centre, const glm::vec3& a_extents) const
+{
+	//project the corners of the box, the nearest corner is compared against the depth buffer over the box's rectangle.
+	//The matrix is linear so each corner is the projected centre plus or minus the projected axes of the box
+	glm::vec4 centre = m_projectionView * glm::vec4(a_centre, 1.0f);
+	glm::vec4 axisX = m_projectionView[0] * a_extents.x, axisY = m_projectionView[1] * a_extents.y, axisZ = m_projectionView[2] * a_extents.z;
+	glm::vec4 minimum, maximum;
+	float minW = FLT_MAX;
+#ifdef OCCLUSION_CULLER_SSE2
+	__m128 axes[3] = { _mm_loadu_ps(&axisX.x), _mm_loadu_ps(&axisY.x), _mm_loadu_ps(&axisZ.x) };
+	__m128 lowest = _mm_set1_ps(FLT_MAX), highest = _mm_set1_ps(-FLT_MAX), lowestW = _mm_set1_ps(FLT_MAX);
+	for (int i = 0; i < 8; ++i)
+	{
+		__m128 clip = _mm_loadu_ps(&centre.x);
+		for (int a = 0; a < 3; ++a)
+		{
+			clip = (i & (1 << a)) ? _mm_add_ps(clip, axes[a]) : _mm_sub_ps(clip, axes[a]);
+		}
+		__m128 w = _mm_shuffle_ps(clip, clip, _MM_SHUFFLE(3, 3, 3, 3));
+		lowestW = _mm_min_ps(lowestW, w);
+		__m128 ndc = _mm_div_ps(clip, w);
+		lowest = _mm_min_ps(lowest, ndc);
+		highest = _mm_max_ps(highest, ndc);
+	}
+	_mm_storeu_ps(&minimum.x, lowest);
+	_mm_storeu_ps(&maximum.x, highest);
+	minW = _mm_cvtss_f32(lowestW);
+#else
+	minimum = glm::vec4(FLT_MAX);
+	maximum = glm::vec4(-FLT_MAX);
+	for (int i = 0; i < 8; ++i)
+	{
+		glm::vec4 clip = centre + ((i & 1) ? axisX : -axisX) + ((i & 2) ? axisY : -axisY) + ((i & 4) ? axisZ : -axisZ);
+		minW = std::min(minW, clip.w);
+		glm::vec4 ndc = clip / clip.w;
+		minimum = glm::min(minimum, ndc);
+		maximum = glm::max(maximum, ndc);
+	}
+#endif
+	if (minW < s_minW) { return true; }
+	float minX = (minimum.x * 0.5f + 0.5f) * m_width, maxX = (maximum.x * 0.5f + 0.5f) * m_width;
+	float minY = (minimum.y * 0.5f + 0.5f) * m_height, maxY = (maximum.y * 0.5f + 0.5f) * m_height;
+	float minZ = minimum.z * 0.5f + 0.5f;
+
+	//boxes off the screen are left to the frustum culler
+	if (maxX < 0.0f || maxY < 0.0f || minX > (float)m_width || minY > (float)m_height) { return true; }
+	minZ = std::min(minZ, 1.0f);
+	int startX = std::max((int)floorf(minX), 0), endX = std::min((int)floorf(maxX), (int)m_width - 1);
+	int startY = std::max((int)floorf(minY), 0), endY = std::min((int)floorf(maxY), (int)m_height - 1);
+
+	for (int tileY = startY / (int)s_tileSize; tileY <= endY / (int)s_tileSize; ++tileY)
+	{
+		for (int tileX = startX / (int)s_tileSize; tileX <= endX / (int)s_tileSize; ++tileX)
+		{
+			//a tile whose farthest pixel is nearer than the box hides all of the box that falls in it
+			if (m_tileDepth[(size_t)tileY * m_tilesWide + tileX] < minZ) { continue; }
+
+			int x0 = std::max(startX, tileX * (int)s_tileSize), x1 = std::min(endX, tileX * (int)s_tileSize + (int)s_tileSize - 1);
+			int y0 = std::max(startY, tileY * (int)s_tileSize), y1 = std::min(endY, tileY * (int)s_tileSize + (int)s_tileSize - 1);
+			for (int y = y0; y <= y1; ++y)
+			{
+				const float* row = &m_depth[(size_t)y * m_width];
+				for (int x = x0; x <= x1; ++x)
+				{
+					if (row[x] >= minZ) { return true; }
+				}
+			}
+		}
+	}
+	return false;
+}
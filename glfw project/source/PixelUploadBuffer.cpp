@@ -0,0 +1,119 @@
+#include "PixelUploadBuffer.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+//allocations are aligned so every upload starts on a boundary that suits any pixel format
+static const size_t s_allocationAlignment = 64;
+
+PixelUploadBuffer::PixelUploadBuffer() : m_bufferID(0), m_capacity(0), m_pData(nullptr), m_regions()
+{
+
+}
+
+PixelUploadBuffer::~PixelUploadBuffer()
+{
+	Destroy();
+}
+
+bool PixelUploadBuffer::Create(size_t a_capacity)
+{
+	Destroy();
+	//a persistent, coherent mapping lets worker threads write into the buffer without any GL calls
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, a_capacity, nullptr, flags);
+	m_pData = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, a_capacity, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (m_pData == nullptr)
+	{
+		std::cout << "Unable to map pixel upload buffer" << std::endl;
+		Destroy();
+		return false;
+	}
+	m_capacity = a_capacity;
+	return true;
+}
+
+void PixelUploadBuffer::Destroy()
+{
+	for (auto iter = m_regions.begin(); iter != m_regions.end(); ++iter)
+	{
+		if (iter->fence != nullptr)
+		{
+			glDeleteSync((GLsync)iter->fence);
+		}
+	}
+	m_regions.clear();
+	if (m_bufferID != 0)
+	{
+		if (m_pData != nullptr)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &m_bufferID);
+	}
+	m_bufferID = 0;
+	m_pData = nullptr;
+	m_capacity = 0;
+}
+
+bool PixelUploadBuffer::Allocate(size_t a_bytes, size_t& a_offset, void*& a_pData)
+{
+	size_t bytes = (a_bytes + s_allocationAlignment - 1) & ~(s_allocationAlignment - 1);
+	if (m_pData == nullptr || bytes == 0 || bytes > m_capacity) { return false; }
+
+	size_t offset = 0;
+	if (!m_regions.empty())
+	{
+		const Region& oldest = m_regions.front();
+		const Region& newest = m_regions.back();
+		size_t head = newest.offset + newest.size;
+		if (newest.offset >= oldest.offset)
+		{
+			//live data is one contiguous range, use the space after it or wrap around to the start
+			if (head + bytes <= m_capacity) { offset = head; }
+			else if (bytes <= oldest.offset) { offset = 0; }
+			else { return false; }
+		}
+		else
+		{
+			//live data has wrapped, the only free space is between the newest and oldest allocations
+			if (head + bytes <= oldest.offset) { offset = head; }
+			else { return false; }
+		}
+	}
+
+	Region region = { offset, bytes, nullptr };
+	m_regions.push_back(region);
+	a_offset = offset;
+	a_pData = m_pData + offset;
+	return true;
+}
+
+void PixelUploadBuffer::Release(size_t a_offset)
+{
+	for (auto iter = m_regions.begin(); iter != m_regions.end(); ++iter)
+	{
+		if (iter->offset == a_offset && iter->fence == nullptr)
+		{
+			iter->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			break;
+		}
+	}
+}
+
+void PixelUploadBuffer::Update()
+{
+	//allocations are reclaimed in order, so stop at the first one that is still in use
+	while (!m_regions.empty() && m_regions.front().fence != nullptr)
+	{
+		GLenum result = glClientWaitSync((GLsync)m_regions.front().fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) { break; }
+		glDeleteSync((GLsync)m_regions.front().fence);
+		m_regions.pop_front();
+	}
+}
@@ -0,0 +1,68 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+//bit positions of the fields of a key
+static const unsigned int s_passShift = 60;
+static const unsigned int s_programShift = 56;
+static const unsigned int s_stateShift = 32;
+static const unsigned int s_depthShift = 16;
+
+uint64_t RenderQueue::MakeKey(unsigned int a_pass, unsigned int a_program, unsigned int a_state, float a_depth)
+{
+	//the top 16 bits of a positive float are its exponent and 7 bits of mantissa, they order the same way the
+	//floats do and give buckets that grow with distance, which is all the precision front to back sorting needs
+	float depth = std::max(a_depth, 0.0f);
+	uint32_t depthBits = 0;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t pass = (a_pass < MaxPass) ? a_pass : MaxPass;
+	uint64_t program = (a_program < MaxProgram) ? a_program : MaxProgram;
+	uint64_t state = (a_state < MaxState) ? a_state : MaxState;
+	return (pass << s_passShift) | (program << s_programShift) | (state << s_stateShift) | ((uint64_t)(depthBits >> 16) << s_depthShift);
+}
+
+void RenderQueue::Push(uint64_t a_key, unsigned int a_index)
+{
+	Item item = { a_key, a_index };
+	m_items.push_back(item);
+}
+
+void RenderQueue::Sort()
+{
+	//least significant digit radix sort a byte at a time, passes over bytes every key has the same value in are
+	//skipped, so the unused low bits and any field that doesn't vary this frame cost nothing
+	size_t count = m_items.size();
+	if (count < 2) { return; }
+	m_scratch.resize(count);
+
+	size_t histograms[8][256] = {};
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint64_t key = m_items[i].key;
+		for (int digit = 0; digit < 8; ++digit)
+		{
+			++histograms[digit][(key >> (digit * 8)) & 0xFF];
+		}
+	}
+
+	for (int digit = 0; digit < 8; ++digit)
+	{
+		size_t* histogram = histograms[digit];
+		if (histogram[(m_items[0].key >> (digit * 8)) & 0xFF] == count) { continue; }
+
+		size_t offset = 0;
+		for (int bucket = 0; bucket < 256; ++bucket)
+		{
+			size_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Item& item = m_items[i];
+			m_scratch[histogram[(item.key >> (digit * 8)) & 0xFF]++] = item;
+		}
+		m_items.swap(m_scratch);
+	}
+}
@@ -0,0 +1,168 @@
+#include "ShaderProgram.h"
+
+#include <algorithm>
+#include <cstring>
+#include <glad/glad.h>
+#include <glm/ext.hpp>
+
+static bool isSamplerType(unsigned int a_type)
+{
+	switch (a_type)
+	{
+	case GL_SAMPLER_1D:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_3D:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_1D_ARRAY:
+	case GL_SAMPLER_2D_ARRAY:
+	case GL_SAMPLER_CUBE_MAP_ARRAY:
+	case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_2D_ARRAY_SHADOW:
+	case GL_SAMPLER_CUBE_SHADOW:
+	case GL_SAMPLER_2D_MULTISAMPLE:
+	case GL_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_2D:
+	case GL_INT_SAMPLER_2D_ARRAY:
+	case GL_UNSIGNED_INT_SAMPLER_2D:
+	case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+		return true;
+	default:
+		return false;
+	}
+}
+
+ShaderProgram::ShaderProgram(unsigned int a_handle) : m_handle(a_handle), m_uniforms(), m_uniformBlocks()
+{
+	Reflect();
+}
+
+ShaderProgram::~ShaderProgram()
+{
+	glDeleteProgram(m_handle);
+}
+
+void ShaderProgram::Reflect()
+{
+	m_uniforms.clear();
+	m_uniformBlocks.clear();
+
+	int uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(m_handle, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(m_handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::vector<char> name(std::max(maxNameLength, 1));
+	for (int i = 0; i < uniformCount; ++i)
+	{
+		int nameLength = 0, count = 0;
+		unsigned int type = 0;
+		glGetActiveUniform(m_handle, i, (GLsizei)name.size(), &nameLength, &count, &type, name.data());
+		Uniform uniform = { std::string(name.data(), nameLength), -1, type, count, -1 };
+		//arrays are reported by their first element
+		if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+		{
+			uniform.name.resize(uniform.name.size() - 3);
+		}
+		//members of uniform blocks don't have a location, they are set through the block's buffer
+		uniform.location = glGetUniformLocation(m_handle, uniform.name.c_str());
+		if (uniform.location >= 0)
+		{
+			m_uniforms.push_back(uniform);
+		}
+	}
+	//name order keeps the units the same in programs that declare the same samplers
+	std::sort(m_uniforms.begin(), m_uniforms.end(), [](const Uniform& a_lhs, const Uniform& a_rhs) { return a_lhs.name < a_rhs.name; });
+
+	int unit = 0;
+	for (auto iter = m_uniforms.begin(); iter != m_uniforms.end(); ++iter)
+	{
+		if (isSamplerType(iter->type))
+		{
+			iter->unit = unit;
+			std::vector<int> units(iter->count);
+			for (int i = 0; i < iter->count; ++i)
+			{
+				units[i] = unit++;
+			}
+			glProgramUniform1iv(m_handle, iter->location, iter->count, units.data());
+		}
+	}
+
+	int blockCount = 0;
+	glGetProgramiv(m_handle, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	glGetProgramiv(m_handle, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+	name.resize(std::max(maxNameLength, 1));
+	for (int i = 0; i < blockCount; ++i)
+	{
+		int nameLength = 0, size = 0;
+		glGetActiveUniformBlockName(m_handle, i, (GLsizei)name.size(), &nameLength, name.data());
+		glGetActiveUniformBlockiv(m_handle, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+		UniformBlock block = { std::string(name.data(), nameLength), (unsigned int)i, size };
+		m_uniformBlocks.push_back(block);
+	}
+}
+
+void ShaderProgram::Use() const
+{
+	glUseProgram(m_handle);
+}
+
+int ShaderProgram::GetUniformLocation(const char* a_name) const
+{
+	const Uniform* pUniform = FindUniform(a_name);
+	return (pUniform != nullptr) ? pUniform->location : -1;
+}
+
+int ShaderProgram::GetSamplerUnit(const char* a_name) const
+{
+	const Uniform* pUniform = FindUniform(a_name);
+	return (pUniform != nullptr) ? pUniform->unit : -1;
+}
+
+unsigned int ShaderProgram::GetUniformBlockIndex(const char* a_name) const
+{
+	for (auto iter = m_uniformBlocks.begin(); iter != m_uniformBlocks.end(); ++iter)
+	{
+		if (iter->name == a_name)
+		{
+			return iter->index;
+		}
+	}
+	return GL_INVALID_INDEX;
+}
+
+void ShaderProgram::SetUniform(int a_location, int a_value) const
+{
+	glProgramUniform1i(m_handle, a_location, a_value);
+}
+
+void ShaderProgram::SetUniform(int a_location, float a_value) const
+{
+	glProgramUniform1f(m_handle, a_location, a_value);
+}
+
+void ShaderProgram::SetUniform(int a_location, const glm::ivec3& a_value) const
+{
+	glProgramUniform3iv(m_handle, a_location, 1, glm::value_ptr(a_value));
+}
+
+void ShaderProgram::SetUniform(int a_location, const glm::vec3& a_value) const
+{
+	glProgramUniform3fv(m_handle, a_location, 1, glm::value_ptr(a_value));
+}
+
+void ShaderProgram::SetUniform(int a_location, const glm::vec4& a_value) const
+{
+	glProgramUniform4fv(m_handle, a_location, 1, glm::value_ptr(a_value));
+}
+
+void ShaderProgram::SetUniform(int a_location, const glm::mat4& a_value) const
+{
+	glProgramUniformMatrix4fv(m_handle, a_location, 1, GL_FALSE, glm::value_ptr(a_value));
+}
+
+const ShaderProgram::Uniform* ShaderProgram::FindUniform(const char* a_name) const
+{
+	//the table is small and sorted, lookups are only made when a program is first used so a binary search is plenty
+	auto iter = std::lower_bound(m_uniforms.begin(), m_uniforms.end(), a_name,
+		[](const Uniform& a_uniform, const char* a_key) { return strcmp(a_uniform.name.c_str(), a_key) < 0; });
+	return (iter != m_uniforms.end() && iter->name == a_name) ? &*iter : nullptr;
+}
@@ -1,6 +1,9 @@
 #include "ShaderUtil.h"
+#include "ShaderProgram.h"
 #include "Utilities.h"
+#include "MemoryTracker.h"
 #include <glad/glad.h>
+#include <algorithm>
 #include <iostream>
 
 //static instance of ShaderUtil
@@ -58,7 +61,8 @@ ShaderUtil::~ShaderUtil()
 	//destroy any programs that are still dangling about
 	for (auto iter = mPrograms.begin(); iter != mPrograms.end(); ++iter)
 	{
-		glDeleteProgram(*iter);
+		MemoryTracker::Free(MemoryTracker::ShaderData, "Shaders", getProgramMemoryUsage((*iter)->GetHandle()));
+		delete *iter;
 	}
 }
 
@@ -96,6 +100,7 @@ unsigned int ShaderUtil::loadShaderInternal(const char* a_filename, unsigned int
 	}
 	//success - add shader to mShader vector
 	mShaders.push_back(shader);
+	mShaderFiles[shader] = Utility::normalisePath(a_filename);
 	return shader;
 }
 
@@ -113,19 +118,20 @@ void ShaderUtil::deleteShaderInernal(unsigned int a_shaderID)
 		if (*iter == a_shaderID) //if we find the shader we are looking for
 		{
 			glDeleteShader(*iter); //delete the shader
+			mShaderFiles.erase(*iter);
 			mShaders.erase(iter); //remove this item from the shaders vector
 			break; //break out of this loop
 		}
 	}
 }
 
-unsigned int ShaderUtil::createProgram(const int& a_vertexShader, const int& a_fragmentShader)
+ShaderProgram* ShaderUtil::createProgram(const int& a_vertexShader, const int& a_fragmentShader)
 {
 	ShaderUtil* instance = ShaderUtil::GetInstance();
 	return instance->createProgramInternal(a_vertexShader, a_fragmentShader);
 }
 
-unsigned int ShaderUtil::createProgramInternal(const int& a_vertexShader, const int& a_fragmentShader)
+ShaderProgram* ShaderUtil::createProgramInternal(const int& a_vertexShader, const int& a_fragmentShader)
 {
 	//bool value to test for shader program linkage success
 	int success = GL_FALSE;
@@ -152,28 +158,127 @@ unsigned int ShaderUtil::createProgramInternal(const int& a_vertexShader, const
 
 		//delete the char buffer now we have displayed it
 		delete[] infoLog;
-		return 0; //return 0, programID 0 is a null program
+		glDeleteProgram(handle);
+		return nullptr;
 	}
+	//wrap the program so its uniforms are reflected once, now it is linked
+	ShaderProgram* program = new ShaderProgram(handle);
 	//add the program to the shader program vector
-	mPrograms.push_back(handle);
-	return handle; //return the program ID
+	mPrograms.push_back(program);
+	//the size of the linked binary is the closest measure we have of the driver memory used by the program
+	MemoryTracker::Allocate(MemoryTracker::ShaderData, "Shaders", getProgramMemoryUsage(handle));
+	return program;
 }
 
-void ShaderUtil::deleteProgram(unsigned int a_program)
+void ShaderUtil::deleteProgram(ShaderProgram* a_program)
 {
 	ShaderUtil* instance = ShaderUtil::GetInstance();
 	instance->deleteProgramInternal(a_program);
 }
 
-void ShaderUtil::deleteProgramInternal(unsigned int a_program)
+void ShaderUtil::deleteProgramInternal(ShaderProgram* a_program)
 {
 	for (auto iter = mPrograms.begin(); iter != mPrograms.end(); ++iter)
 	{
 		if (*iter == a_program) //if we find the shader we are looking for
 		{
-			glDeleteProgram(*iter); //delete the shader
+			MemoryTracker::Free(MemoryTracker::ShaderData, "Shaders", getProgramMemoryUsage((*iter)->GetHandle()));
+			delete *iter; //delete the program
 			mPrograms.erase(iter); //remove this item from the shaders vector
 			break; //break out of the loop
 		}
 	}
-}
\ No newline at end of file
+}
+
+size_t ShaderUtil::getProgramMemoryUsage(unsigned int a_program)
+{
+	int binaryLength = 0;
+	glGetProgramiv(a_program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	return (size_t)binaryLength;
+}
+unsigned int ShaderUtil::reloadShaderFile(const std::string& a_filename)
+{
+	ShaderUtil* instance = ShaderUtil::GetInstance();
+	return instance->reloadShaderFileInternal(a_filename);
+}
+
+unsigned int ShaderUtil::reloadShaderFileInternal(const std::string& a_filename)
+{
+	std::string filename = Utility::normalisePath(a_filename);
+	//collect the matching shaders first as loading the replacements adds to mShaderFiles
+	std::vector<unsigned int> shaders;
+	for (auto iter = mShaderFiles.begin(); iter != mShaderFiles.end(); ++iter)
+	{
+		if (iter->second == filename)
+		{
+			shaders.push_back(iter->first);
+		}
+	}
+
+	unsigned int relinked = 0;
+	for (auto shaderIter = shaders.begin(); shaderIter != shaders.end(); ++shaderIter)
+	{
+		int type = 0;
+		glGetShaderiv(*shaderIter, GL_SHADER_TYPE, &type);
+		//a shader that fails to compile is reported by loadShaderInternal, keep using the old one
+		unsigned int newShader = loadShaderInternal(filename.c_str(), type);
+		if (newShader == 0) { continue; }
+
+		bool success = true;
+		for (auto programIter = mPrograms.begin(); programIter != mPrograms.end(); ++programIter)
+		{
+			unsigned int handle = (*programIter)->GetHandle();
+			int shaderCount = 0;
+			glGetProgramiv(handle, GL_ATTACHED_SHADERS, &shaderCount);
+			std::vector<unsigned int> attached(shaderCount);
+			glGetAttachedShaders(handle, shaderCount, nullptr, attached.data());
+			if (std::find(attached.begin(), attached.end(), *shaderIter) == attached.end()) { continue; }
+
+			if (relinkProgram(*programIter, *shaderIter, newShader))
+			{
+				++relinked;
+			}
+			else
+			{
+				success = false;
+			}
+		}
+		//if any program had to fall back to the old shader it is still in use and the new one is discarded
+		deleteShaderInernal(success ? *shaderIter : newShader);
+	}
+	return relinked;
+}
+
+bool ShaderUtil::relinkProgram(ShaderProgram* a_program, unsigned int a_oldShader, unsigned int a_newShader)
+{
+	unsigned int handle = a_program->GetHandle();
+	size_t oldUsage = getProgramMemoryUsage(handle);
+
+	glDetachShader(handle, a_oldShader);
+	glAttachShader(handle, a_newShader);
+	glLinkProgram(handle);
+
+	int success = GL_FALSE;
+	glGetProgramiv(handle, GL_LINK_STATUS, &success);
+	if (GL_FALSE == success)
+	{
+		int infoLogLength = 0;
+		glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &infoLogLength);
+		char* infoLog = new char[infoLogLength];
+		glGetProgramInfoLog(handle, infoLogLength, 0, infoLog);
+		std::cout << "Shader Linker Error during reload, keeping previous program" << std::endl;
+		std::cout << infoLog << std::endl;
+		delete[] infoLog;
+
+		//put the old shader back and link again so the program stays usable
+		glDetachShader(handle, a_newShader);
+		glAttachShader(handle, a_oldShader);
+		glLinkProgram(handle);
+	}
+	//relinking resets uniforms and may move them, so the table and sampler units are rebuilt either way
+	a_program->Reflect();
+
+	MemoryTracker::Free(MemoryTracker::ShaderData, "Shaders", oldUsage);
+	MemoryTracker::Allocate(MemoryTracker::ShaderData, "Shaders", getProgramMemoryUsage(handle));
+	return GL_FALSE != success;
+}
@@ -1,11 +1,22 @@
 #include "Texture.h"
+#include "TgaDecoder.h"
+#include "ThreadPool.h"
 
 #include <stb_image.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <glad/glad.h>
 
-Texture::Texture() : m_filename(), m_width(0), m_height(0), m_textureID(0)
+Texture::Texture() : m_filename(), m_width(0), m_height(0), m_textureID(0), m_memoryUsage(0),
+	m_usage(TextureCompressor::ColourMap), m_compressed(false)
 {
+	m_layout.format = TextureCompressor::Uncompressed;
+	m_layout.width = m_layout.height = 0;
+	m_layout.firstLevel = m_layout.endLevel = 0;
 
 }
 
@@ -14,74 +25,290 @@ Texture::~Texture()
 	unload();
 }
 
-bool Texture::Load(std::string a_filepath)
+bool Texture::Load(std::string a_filepath, TextureCompressor::Usage a_usage, bool a_compress)
 {
 	//convert the image data into OpenGL format
-	int width = 0, height = 0, channels = 0;
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char* imageData = stbi_load(a_filepath.c_str(), &width, &height, &channels, 4);
-	if (imageData != nullptr)
+	int width = 0, height = 0;
+	if (GetImageInfo(a_filepath, width, height))
+	{
+		std::vector<unsigned char> imageData(TextureCompressor::GetMaxImageSize(width, height));
+		TextureCompressor::ImageLayout layout;
+		if (TextureCompressor::PrepareImage(a_filepath, a_usage, a_compress, width, height, 0, layout, imageData.data()))
+		{
+			m_filename = a_filepath;
+			m_usage = a_usage;
+			m_compressed = a_compress;
+			Upload(layout, imageData.data());
+			std::cout << "Successfully loaded Image File: " << a_filepath << std::endl;
+			return true;
+		}
+	}
+	std::cout << "Failed to open Image File: " << a_filepath << std::endl;
+	return false;
+}
+
+void Texture::CreatePlaceholder(const std::string& a_filename, TextureCompressor::Usage a_usage, bool a_compress)
+{
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	m_filename = a_filename;
+	m_usage = a_usage;
+	m_compressed = a_compress;
+	Upload(1, 1, white);
+}
+
+bool Texture::ReadImageFile(const std::string& a_filename, std::vector<unsigned char>& a_data)
+{
+	std::ifstream file(a_filename, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+	if (!file.is_open()) { return false; }
+	a_data.resize((size_t)file.tellg());
+	file.seekg(0);
+	return (bool)file.read((char*)a_data.data(), a_data.size());
+}
+
+bool Texture::DecodeImage(const std::string& a_filename, const std::vector<unsigned char>& a_data, bool a_flipVertically,
+	unsigned int a_width, unsigned int a_height, unsigned char* a_output)
+{
+	//TGA files don't have a signature, so only files with the extension are given to the TGA decoder
+	std::string extension = std::filesystem::path(a_filename).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	unsigned int width = 0, height = 0;
+	if (extension == ".tga" && TgaDecoder::GetInfo(a_data.data(), a_data.size(), width, height))
+	{
+		return width == a_width && height == a_height && TgaDecoder::Decode(a_data.data(), a_data.size(), a_flipVertically, a_output);
+	}
+
+	//everything else is decoded by stb_image and copied across, the thread local flip setting keeps decodes
+	//on different threads from affecting each other
+	int stbWidth = 0, stbHeight = 0, channels = 0;
+	stbi_set_flip_vertically_on_load_thread(a_flipVertically ? 1 : 0);
+	unsigned char* pixels = stbi_load_from_memory(a_data.data(), (int)a_data.size(), &stbWidth, &stbHeight, &channels, 4);
+	bool decoded = (pixels != nullptr && (unsigned int)stbWidth == a_width && (unsigned int)stbHeight == a_height);
+	if (decoded)
+	{
+		memcpy(a_output, pixels, (size_t)a_width * a_height * 4);
+	}
+	stbi_image_free(pixels);
+	return decoded;
+}
+
+bool Texture::GetImageInfo(const std::string& a_filename, int& a_width, int& a_height)
+{
+	int channels = 0;
+	return stbi_info(a_filename.c_str(), &a_width, &a_height, &channels) != 0;
+}
+
+void Texture::Upload(unsigned int a_width, unsigned int a_height, const void* a_pixels)
+{
+	//a single RGBA8 level is a complete chain of one level
+	TextureCompressor::ImageLayout layout;
+	layout.format = TextureCompressor::Uncompressed;
+	layout.width = a_width;
+	layout.height = a_height;
+	layout.levelSizes.push_back((size_t)a_width * a_height * 4);
+	layout.firstLevel = 0;
+	layout.endLevel = 1;
+	Upload(layout, a_pixels);
+}
+
+void Texture::Upload(const TextureCompressor::ImageLayout& a_layout, const void* a_data)
+{
+	//a reload respecifies the storage of the existing texture rather than creating a new one
+	if (m_textureID == 0)
 	{
-		m_filename = a_filepath;
-		m_width = width;
-		m_height = height;
 		glGenTextures(1, &m_textureID);
-		glBindTexture(GL_TEXTURE_2D, m_textureID);
+	}
+	glBindTexture(GL_TEXTURE_2D, m_textureID);
+
+	//levels that run up to the current base level are streamed in below it, anything else replaces the image
+	bool streaming = (a_layout.endLevel == m_layout.firstLevel && a_layout.endLevel < m_layout.levelSizes.size() &&
+		a_layout.format == m_layout.format && a_layout.width == m_width && a_layout.height == m_height);
+	if (!streaming)
+	{
+		//free the levels of the old image that the new one doesn't cover before they are forgotten
+		for (unsigned int level = m_layout.firstLevel; level < a_layout.firstLevel && level < m_layout.levelSizes.size(); ++level)
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, TextureCompressor::GetGLFormat(m_layout.format), 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+		m_width = a_layout.width;
+		m_height = a_layout.height;
+		m_layout = a_layout;
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		stbi_image_free(imageData);
-		std::cout << "Successfully loaded Image File: " << a_filepath << std::endl;
-		return true;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)a_layout.levelSizes.size() - 1);
 	}
-	std::cout << "Failed to open Image File: " << a_filepath << std::endl;
-	return false;
+
+	//the mip chain was built on the CPU so each level is uploaded as it is
+	//rows of formats with fewer than 4 channels are tightly packed, so aren't aligned to 4 bytes
+	unsigned int format = TextureCompressor::GetGLFormat(a_layout.format);
+	bool compressed = TextureCompressor::IsCompressedFormat(a_layout.format);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	const unsigned char* levelData = (const unsigned char*)a_data;
+	for (unsigned int level = a_layout.firstLevel; level < a_layout.endLevel; ++level)
+	{
+		unsigned int w = std::max(m_width >> level, 1u), h = std::max(m_height >> level, 1u);
+		if (!compressed)
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, TextureCompressor::GetGLPixelFormat(a_layout.format), GL_UNSIGNED_BYTE, levelData);
+		}
+		else
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, (GLsizei)a_layout.levelSizes[level], levelData);
+		}
+		levelData += a_layout.levelSizes[level];
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	//only sample from the levels that are resident, the new levels are complete so the base can move down to them
+	m_layout.firstLevel = a_layout.firstLevel;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)m_layout.firstLevel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	UpdateMemoryUsage();
 }
 
-unsigned int Texture::LoadCubeMap(std::vector<std::string> a_filenames, unsigned int* cubemap_face_id)
+void Texture::EvictLevels(unsigned int a_baseLevel)
 {
-	glGenTextures(1, &m_textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_textureID);
+	if (m_textureID == 0 || a_baseLevel <= m_layout.firstLevel || a_baseLevel >= m_layout.levelSizes.size()) { return; }
+	//stop sampling from the levels before releasing them
+	glBindTexture(GL_TEXTURE_2D, m_textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)a_baseLevel);
+	for (unsigned int level = m_layout.firstLevel; level < a_baseLevel; ++level)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, TextureCompressor::GetGLFormat(m_layout.format), 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_layout.firstLevel = a_baseLevel;
+	UpdateMemoryUsage();
+}
 
-	int width, height, nrChannels;
+void Texture::AllocateLevels(unsigned int a_firstLevel)
+{
+	if (m_textureID == 0 || a_firstLevel >= m_layout.firstLevel) { return; }
+	unsigned int format = TextureCompressor::GetGLFormat(m_layout.format);
+	bool compressed = TextureCompressor::IsCompressedFormat(m_layout.format);
+	glBindTexture(GL_TEXTURE_2D, m_textureID);
+	for (unsigned int level = a_firstLevel; level < m_layout.firstLevel; ++level)
+	{
+		unsigned int w = std::max(m_width >> level, 1u), h = std::max(m_height >> level, 1u);
+		if (!compressed)
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, TextureCompressor::GetGLPixelFormat(m_layout.format), GL_UNSIGNED_BYTE, nullptr);
+		}
+		else
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, (GLsizei)m_layout.levelSizes[level], nullptr);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)a_firstLevel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_layout.firstLevel = a_firstLevel;
+	UpdateMemoryUsage();
+}
 
-	for (int i = 0; i <a_filenames.size(); ++i) //for each image file of the skybox
+void Texture::UpdateMemoryUsage()
+{
+	m_memoryUsage = 0;
+	for (size_t level = m_layout.firstLevel; level < m_layout.levelSizes.size(); ++level)
 	{
-		unsigned char* data;
-		stbi_set_flip_vertically_on_load(false);
-		data = stbi_load(a_filenames[i].c_str(), &width, &height, &nrChannels, 4);
-		if (data != nullptr)
+		m_memoryUsage += m_layout.levelSizes[level];
+	}
+}
+
+unsigned int Texture::LoadCubeMap(std::vector<std::string> a_filenames, unsigned int* cubemap_face_id, bool a_compress)
+{
+	if (m_textureID == 0)
+	{
+		glGenTextures(1, &m_textureID);
+	}
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_textureID);
+	m_cubeMapFaces = a_filenames;
+	m_cubeMapFaceIDs.assign(cubemap_face_id, cubemap_face_id + a_filenames.size());
+	m_compressed = a_compress;
+
+	//the faces are prepared at the same time on the thread pool, each one is read from its texture cache
+	//if it is up to date, otherwise it is decoded, its mips built and compressed, and the cache written for next time
+	size_t faceCount = a_filenames.size();
+	std::vector<TextureCompressor::ImageLayout> layouts(faceCount);
+	std::vector<std::vector<unsigned char>> faceData(faceCount);
+	std::vector<char> prepared(faceCount, 0);
+	ThreadPool::GetInstance()->ParallelFor((unsigned int)faceCount, [&](unsigned int a_face)
+	{
+		int width = 0, height = 0;
+		if (GetImageInfo(a_filenames[a_face], width, height))
 		{
-			m_width = width;
-			m_height = height;
-			//texturing allows elements of an image array to be read by shaders
-			glTexImage2D(cubemap_face_id[i], 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+			faceData[a_face].resize(TextureCompressor::GetMaxImageSize(width, height));
+			prepared[a_face] = TextureCompressor::PrepareImage(a_filenames[a_face], TextureCompressor::CubeMapFace, a_compress,
+				width, height, 0, layouts[a_face], faceData[a_face].data());
+		}
+	});
 
-			stbi_image_free(data);
+	m_memoryUsage = 0;
+	unsigned int levelCount = 0;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t i = 0; i < faceCount; ++i) //for each image file of the skybox
+	{
+		if (prepared[i])
+		{
+			const TextureCompressor::ImageLayout& layout = layouts[i];
+			m_width = layout.width;
+			m_height = layout.height;
+			levelCount = (levelCount == 0) ? (unsigned int)layout.levelSizes.size() : std::min(levelCount, (unsigned int)layout.levelSizes.size());
+			unsigned int format = TextureCompressor::GetGLFormat(layout.format);
+			const unsigned char* levelData = faceData[i].data();
+			for (unsigned int level = 0; level < layout.levelSizes.size(); ++level)
+			{
+				unsigned int w = std::max(layout.width >> level, 1u), h = std::max(layout.height >> level, 1u);
+				if (TextureCompressor::IsCompressedFormat(layout.format))
+				{
+					glCompressedTexImage2D(cubemap_face_id[i], level, format, w, h, 0, (GLsizei)layout.levelSizes[level], levelData);
+				}
+				else
+				{
+					glTexImage2D(cubemap_face_id[i], level, format, w, h, 0, TextureCompressor::GetGLPixelFormat(layout.format), GL_UNSIGNED_BYTE, levelData);
+				}
+				levelData += layout.levelSizes[level];
+				m_memoryUsage += layout.levelSizes[level];
+			}
 
 			std::cout << "Successfully loaded Image File: " << a_filenames[i] << std::endl;
 		}
 		else
 		{
 			std::cout << "Failed to open Image File: " << a_filenames[i] << std::endl;
-			stbi_image_free(data);
 		}
 	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 	
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	//faces of different sizes only sample the levels they all have
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, (levelCount > 0) ? (GLint)levelCount - 1 : 0);
 
 	return m_textureID;
 }
 
+bool Texture::Reload()
+{
+	if (m_textureID == 0) { return false; }
+	if (!m_cubeMapFaces.empty())
+	{
+		//copy the face lists as LoadCubeMap stores them again
+		std::vector<std::string> faces = m_cubeMapFaces;
+		std::vector<unsigned int> faceIDs = m_cubeMapFaceIDs;
+		LoadCubeMap(faces, faceIDs.data(), m_compressed);
+		return true;
+	}
+	return Load(m_filename, m_usage, m_compressed);
+}
+
 void Texture::unload()
 {
 	glDeleteTextures(1, &m_textureID);
+	m_textureID = 0;
+	m_memoryUsage = 0;
+	m_layout.levelSizes.clear();
+	m_layout.firstLevel = m_layout.endLevel = 0;
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "TextureArray.h"
+#include "Texture.h"
+
+#include <algorithm>
+#include <glad/glad.h>
+
+//number of layers a new array is created with, it doubles each time it fills up
+static const unsigned int s_initialLayerCount = 4;
+
+TextureArray::TextureArray(const TextureCompressor::ImageLayout& a_layout) : m_layout(a_layout), m_textureID(0), m_layerCount(0), m_layerSize(0), m_usedLayers()
+{
+	for (auto iter = m_layout.levelSizes.begin(); iter != m_layout.levelSizes.end(); ++iter)
+	{
+		m_layerSize += *iter;
+	}
+	Resize(s_initialLayerCount);
+}
+
+TextureArray::~TextureArray()
+{
+	glDeleteTextures(1, &m_textureID);
+}
+
+bool TextureArray::Matches(const TextureCompressor::ImageLayout& a_layout) const
+{
+	return a_layout.format == m_layout.format && a_layout.width == m_layout.width && a_layout.height == m_layout.height &&
+		a_layout.levelSizes.size() == m_layout.levelSizes.size();
+}
+
+int TextureArray::AddLayer()
+{
+	auto freeLayer = std::find(m_usedLayers.begin(), m_usedLayers.end(), false);
+	if (freeLayer == m_usedLayers.end())
+	{
+		Resize(m_layerCount * 2);
+		freeLayer = std::find(m_usedLayers.begin(), m_usedLayers.end(), false);
+	}
+	int layer = (int)(freeLayer - m_usedLayers.begin());
+	m_usedLayers[layer] = true;
+	return layer;
+}
+
+int TextureArray::AddTexture(const Texture* a_pTexture)
+{
+	int layer = AddLayer();
+	//the copy stays on the GPU, compressed blocks are copied as they are
+	unsigned int firstLevel = GetFirstLevel(a_pTexture->GetLayout().levelSizes.size());
+	for (unsigned int level = 0; level < m_layout.levelSizes.size(); ++level)
+	{
+		int w = std::max(m_layout.width >> level, 1u), h = std::max(m_layout.height >> level, 1u);
+		glCopyImageSubData(a_pTexture->GetTextureID(), GL_TEXTURE_2D, firstLevel + level, 0, 0, 0,
+			m_textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, w, h, 1);
+	}
+	return layer;
+}
+
+void TextureArray::CopyLayer(int a_layer, const TextureArray& a_source, int a_sourceLayer)
+{
+	//both arrays hold the end of the same chain, so their levels line up from the smallest
+	size_t levelCount = m_layout.levelSizes.size(), sourceCount = a_source.m_layout.levelSizes.size();
+	for (size_t level = (levelCount > sourceCount) ? levelCount - sourceCount : 0; level < levelCount; ++level)
+	{
+		unsigned int sourceLevel = (unsigned int)(level + sourceCount - levelCount);
+		int w = std::max(m_layout.width >> level, 1u), h = std::max(m_layout.height >> level, 1u);
+		glCopyImageSubData(a_source.m_textureID, GL_TEXTURE_2D_ARRAY, sourceLevel, 0, 0, a_sourceLayer,
+			m_textureID, GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, a_layer, w, h, 1);
+	}
+}
+
+void TextureArray::UploadLevels(int a_layer, const TextureCompressor::ImageLayout& a_layout, const void* a_data)
+{
+	unsigned int firstLevel = GetFirstLevel(a_layout.levelSizes.size());
+	unsigned int format = TextureCompressor::GetGLFormat(m_layout.format);
+	bool compressed = TextureCompressor::IsCompressedFormat(m_layout.format);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	const unsigned char* levelData = (const unsigned char*)a_data;
+	for (unsigned int level = a_layout.firstLevel; level < a_layout.endLevel; ++level)
+	{
+		if (level >= firstLevel)
+		{
+			unsigned int arrayLevel = level - firstLevel;
+			int w = std::max(m_layout.width >> arrayLevel, 1u), h = std::max(m_layout.height >> arrayLevel, 1u);
+			if (!compressed)
+			{
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, arrayLevel, 0, 0, a_layer, w, h, 1, TextureCompressor::GetGLPixelFormat(m_layout.format), GL_UNSIGNED_BYTE, levelData);
+			}
+			else
+			{
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, arrayLevel, 0, 0, a_layer, w, h, 1, format, (GLsizei)a_layout.levelSizes[level], levelData);
+			}
+		}
+		levelData += a_layout.levelSizes[level];
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::CopyToTexture(int a_layer, Texture* a_pTexture) const
+{
+	unsigned int firstLevel = GetFirstLevel(a_pTexture->GetLayout().levelSizes.size());
+	unsigned int endLevel = a_pTexture->GetLayout().firstLevel;
+	if (firstLevel >= endLevel) { return; }
+	a_pTexture->AllocateLevels(firstLevel);
+	for (unsigned int level = firstLevel; level < endLevel; ++level)
+	{
+		unsigned int arrayLevel = level - firstLevel;
+		int w = std::max(m_layout.width >> arrayLevel, 1u), h = std::max(m_layout.height >> arrayLevel, 1u);
+		glCopyImageSubData(m_textureID, GL_TEXTURE_2D_ARRAY, arrayLevel, 0, 0, a_layer,
+			a_pTexture->GetTextureID(), GL_TEXTURE_2D, level, 0, 0, 0, w, h, 1);
+	}
+}
+
+void TextureArray::RemoveLayer(int a_layer)
+{
+	if (a_layer >= 0 && a_layer < (int)m_usedLayers.size())
+	{
+		m_usedLayers[a_layer] = false;
+	}
+}
+
+bool TextureArray::IsEmpty() const
+{
+	return std::find(m_usedLayers.begin(), m_usedLayers.end(), true) == m_usedLayers.end();
+}
+
+void TextureArray::Resize(unsigned int a_layerCount)
+{
+	//texture storage is immutable, so a larger array is created and the old layers copied into it
+	unsigned int textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, (GLsizei)m_layout.levelSizes.size(), TextureCompressor::GetGLFormat(m_layout.format), m_layout.width, m_layout.height, a_layerCount);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	if (m_textureID != 0)
+	{
+		for (unsigned int level = 0; level < m_layout.levelSizes.size(); ++level)
+		{
+			int w = std::max(m_layout.width >> level, 1u), h = std::max(m_layout.height >> level, 1u);
+			glCopyImageSubData(m_textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+				textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, w, h, m_layerCount);
+		}
+		glDeleteTextures(1, &m_textureID);
+	}
+	m_textureID = textureID;
+	m_layerCount = a_layerCount;
+	m_usedLayers.resize(a_layerCount, false);
+}
@@ -0,0 +1,430 @@
+#include "TextureCompressor.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <glad/glad.h>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
+
+//the S3TC formats come from EXT_texture_compression_s3tc which the GL headers don't include
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+//identifies a texture cache file, the digit is the version of the layout
+static const char s_textureCacheMagic[4] = { 'O', 'T', 'C', '4' };
+//number of rows of a mip level filtered by each job
+static const unsigned int s_mipBandHeight = 32;
+
+//bytes in one 4x4 block of each format
+static size_t getBlockSize(TextureCompressor::Format a_format)
+{
+	return (a_format == TextureCompressor::BC1 || a_format == TextureCompressor::BC4) ? 8 : 16;
+}
+
+//bytes in one texel of each uncompressed format
+static size_t getTexelSize(TextureCompressor::Format a_format)
+{
+	switch (a_format)
+	{
+	case TextureCompressor::R8: return 1;
+	case TextureCompressor::RG8: return 2;
+	case TextureCompressor::RGB8: return 3;
+	default: return 4;
+	}
+}
+
+//the size and modification time of the image file, stored in the cache to tell when it is out of date
+static bool getSourceFileInfo(const std::string& a_filename, long long& a_size, long long& a_modifiedTime)
+{
+	std::error_code error;
+	a_size = (long long)std::filesystem::file_size(a_filename, error);
+	if (error) { return false; }
+	a_modifiedTime = (long long)std::filesystem::last_write_time(a_filename, error).time_since_epoch().count();
+	return !error;
+}
+
+size_t TextureCompressor::GetMaxImageSize(unsigned int a_width, unsigned int a_height)
+{
+	//an RGBA8 chain is the largest except for tiny images, where a 16 byte block holds fewer texels
+	size_t maxSize = 0;
+	const Format formats[2] = { Uncompressed, BC3 };
+	for (unsigned int i = 0; i < 2; ++i)
+	{
+		std::vector<size_t> levelSizes;
+		GetLevelSizes(formats[i], a_width, a_height, levelSizes);
+		size_t size = 0;
+		for (auto iter = levelSizes.begin(); iter != levelSizes.end(); ++iter)
+		{
+			size += *iter;
+		}
+		maxSize = std::max(maxSize, size);
+	}
+	return maxSize;
+}
+
+bool TextureCompressor::PrepareImage(const std::string& a_filename, Usage a_usage, bool a_compress, unsigned int a_width, unsigned int a_height,
+	unsigned int a_firstLevel, ImageLayout& a_layout, unsigned char* a_output, SourceFile* a_pSource)
+{
+	unsigned int levelCount = GetLevelCount(a_width, a_height);
+	a_firstLevel = std::min(a_firstLevel, levelCount - 1);
+	//the cache is used for compressed images and for streaming, which reads the larger levels back from it
+	bool useCache = a_compress || a_firstLevel > 0;
+	unsigned long long sourceHash = 0;
+	if (useCache && ReadCachedLevels(a_filename, a_usage, a_compress, a_width, a_height, a_firstLevel, levelCount, a_layout, a_output, &sourceHash))
+	{
+		if (a_pSource != nullptr && !a_pSource->hashed)
+		{
+			a_pSource->hash = sourceHash;
+			a_pSource->hashed = true;
+		}
+		return true;
+	}
+
+	//the file is hashed from the bytes read to decode it
+	SourceFile source = { std::vector<unsigned char>(), 0, false };
+	SourceFile& file = (a_pSource != nullptr) ? *a_pSource : source;
+	if (file.data.empty() && !Texture::ReadImageFile(a_filename, file.data))
+	{
+		return false;
+	}
+	if (!file.hashed)
+	{
+		file.hash = Utility::hashBytes(file.data.data(), file.data.size());
+		file.hashed = true;
+	}
+
+	//the output is large enough for the RGBA8 chain, so the image is decoded and its mips built in place
+	//the decode fails if the file has changed size since its size was read
+	//textures are flipped to match OpenGL's bottom up rows, cube map faces are defined top down
+	if (!Texture::DecodeImage(a_filename, file.data, a_usage != CubeMapFace, a_width, a_height, a_output))
+	{
+		return false;
+	}
+
+	a_layout.width = a_width;
+	a_layout.height = a_height;
+	a_layout.format = ChooseFormat(a_usage, a_compress, a_output, a_width, a_height);
+	a_layout.firstLevel = 0;
+	a_layout.endLevel = levelCount;
+	GetLevelSizes(a_layout.format, a_width, a_height, a_layout.levelSizes);
+	GenerateMips(a_output, a_usage, a_width, a_height);
+	if (IsCompressedFormat(a_layout.format))
+	{
+		//the compressed chain is a fraction of the size, it is built in temporary memory then copied over the mips
+		size_t compressedSize = 0;
+		for (auto iter = a_layout.levelSizes.begin(); iter != a_layout.levelSizes.end(); ++iter)
+		{
+			compressedSize += *iter;
+		}
+		std::vector<unsigned char> compressed(compressedSize);
+		Compress(a_output, a_layout, compressed.data());
+		memcpy(a_output, compressed.data(), compressedSize);
+	}
+	else if (a_layout.format != Uncompressed)
+	{
+		PackChannels(a_output, a_layout, a_output);
+	}
+
+	if (useCache && WriteCache(a_filename, a_usage, file.hash, a_layout, a_output) && a_firstLevel > 0)
+	{
+		//only hand back the levels that were asked for, the rest can be streamed from the cache
+		size_t skipped = 0, kept = 0;
+		for (unsigned int i = 0; i < levelCount; ++i)
+		{
+			(i < a_firstLevel ? skipped : kept) += a_layout.levelSizes[i];
+		}
+		memmove(a_output, a_output + skipped, kept);
+		a_layout.firstLevel = a_firstLevel;
+	}
+	return true;
+}
+
+bool TextureCompressor::ReadCachedLevels(const std::string& a_filename, Usage a_usage, bool a_compress, unsigned int a_width, unsigned int a_height,
+	unsigned int a_firstLevel, unsigned int a_endLevel, ImageLayout& a_layout, unsigned char* a_output, unsigned long long* a_pSourceHash)
+{
+	long long sourceSize = 0, sourceTime = 0;
+	if (!getSourceFileInfo(a_filename, sourceSize, sourceTime)) { return false; }
+
+	std::ifstream cacheFile(a_filename + ".texcache", std::ios_base::in | std::ios_base::binary);
+	if (!cacheFile.is_open()) { return false; }
+
+	char magic[4];
+	long long cacheSize = 0, cacheTime = 0;
+	unsigned long long sourceHash = 0;
+	unsigned int usage = 0, format = 0, levelCount = 0;
+	cacheFile.read(magic, sizeof(magic));
+	cacheFile.read((char*)&cacheSize, sizeof(cacheSize));
+	cacheFile.read((char*)&cacheTime, sizeof(cacheTime));
+	cacheFile.read((char*)&sourceHash, sizeof(sourceHash));
+	cacheFile.read((char*)&usage, sizeof(usage));
+	cacheFile.read((char*)&format, sizeof(format));
+	cacheFile.read((char*)&a_layout.width, sizeof(a_layout.width));
+	cacheFile.read((char*)&a_layout.height, sizeof(a_layout.height));
+	cacheFile.read((char*)&levelCount, sizeof(levelCount));
+	if (!cacheFile || memcmp(magic, s_textureCacheMagic, sizeof(magic)) != 0 || format > RGB8)
+	{
+		return false;
+	}
+	//the cache is only valid for the same version of the image prepared the same way
+	if (cacheSize != sourceSize || cacheTime != sourceTime || usage != (unsigned int)a_usage || IsCompressedFormat((Format)format) != a_compress ||
+		a_layout.width != a_width || a_layout.height != a_height)
+	{
+		std::cout << "Texture cache is out of date: " << a_filename << ".texcache" << std::endl;
+		return false;
+	}
+
+	a_layout.format = (Format)format;
+	GetLevelSizes(a_layout.format, a_width, a_height, a_layout.levelSizes);
+	if (levelCount != a_layout.levelSizes.size() || a_firstLevel >= a_endLevel || a_endLevel > levelCount)
+	{
+		std::cout << "Texture cache is damaged: " << a_filename << ".texcache" << std::endl;
+		return false;
+	}
+	//skip the levels before the first one wanted
+	size_t offset = 0, dataSize = 0;
+	for (unsigned int i = 0; i < a_endLevel; ++i)
+	{
+		(i < a_firstLevel ? offset : dataSize) += a_layout.levelSizes[i];
+	}
+	cacheFile.seekg(offset, std::ios_base::cur);
+	if (!cacheFile.read((char*)a_output, dataSize))
+	{
+		std::cout << "Texture cache is damaged: " << a_filename << ".texcache" << std::endl;
+		return false;
+	}
+	a_layout.firstLevel = a_firstLevel;
+	a_layout.endLevel = a_endLevel;
+	if (a_pSourceHash != nullptr)
+	{
+		*a_pSourceHash = sourceHash;
+	}
+	return true;
+}
+
+unsigned int TextureCompressor::GetLevelCount(unsigned int a_width, unsigned int a_height)
+{
+	unsigned int levelCount = 1;
+	for (unsigned int size = std::max(a_width, a_height); size > 1; size /= 2)
+	{
+		++levelCount;
+	}
+	return levelCount;
+}
+
+unsigned int TextureCompressor::GetGLFormat(Format a_format)
+{
+	switch (a_format)
+	{
+	case BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BC4: return GL_COMPRESSED_RED_RGTC1;
+	case BC5: return GL_COMPRESSED_RG_RGTC2;
+	case R8: return GL_R8;
+	case RG8: return GL_RG8;
+	case RGB8: return GL_RGB8;
+	default: return GL_RGBA8;
+	}
+}
+
+unsigned int TextureCompressor::GetGLPixelFormat(Format a_format)
+{
+	switch (a_format)
+	{
+	case R8: return GL_RED;
+	case RG8: return GL_RG;
+	case RGB8: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+TextureCompressor::Format TextureCompressor::ChooseFormat(Usage a_usage, bool a_compress, const unsigned char* a_pixels, unsigned int a_width, unsigned int a_height)
+{
+	switch (a_usage)
+	{
+	case SpecularMap: return a_compress ? BC4 : R8;
+	case NormalMap: return a_compress ? BC5 : RG8;
+	default:
+		//only pay for the alpha channel if the image actually has transparency, images decoded without an
+		//alpha channel are given an opaque one so this also covers their channel count
+		for (size_t i = 0, count = (size_t)a_width * a_height; i < count; ++i)
+		{
+			if (a_pixels[i * 4 + 3] != 255) { return a_compress ? BC3 : Uncompressed; }
+		}
+		return a_compress ? BC1 : RGB8;
+	}
+}
+
+void TextureCompressor::GetLevelSizes(Format a_format, unsigned int a_width, unsigned int a_height, std::vector<size_t>& a_levelSizes)
+{
+	a_levelSizes.clear();
+	for (unsigned int w = a_width, h = a_height; ; w = (w > 1) ? w / 2 : 1, h = (h > 1) ? h / 2 : 1)
+	{
+		if (!IsCompressedFormat(a_format))
+		{
+			a_levelSizes.push_back((size_t)w * h * getTexelSize(a_format));
+		}
+		else
+		{
+			a_levelSizes.push_back((size_t)((w + 3) / 4) * ((h + 3) / 4) * getBlockSize(a_format));
+		}
+		if (w == 1 && h == 1) { break; }
+	}
+}
+
+void TextureCompressor::GenerateMips(unsigned char* a_mips, Usage a_usage, unsigned int a_width, unsigned int a_height)
+{
+	//colour maps are stored as sRGB so are averaged in linear space, the other maps hold data that is already linear
+	bool colour = (a_usage == ColourMap || a_usage == CubeMapFace);
+	stbir_colorspace colourSpace = colour ? STBIR_COLORSPACE_SRGB : STBIR_COLORSPACE_LINEAR;
+	int alphaChannel = colour ? 3 : STBIR_ALPHA_CHANNEL_NONE;
+	//cube map faces meet a different face at each edge, so clamping is closer than wrapping to the opposite edge
+	stbir_edge edge = (a_usage == CubeMapFace) ? STBIR_EDGE_CLAMP : STBIR_EDGE_WRAP;
+
+	const unsigned char* level = a_mips;
+	unsigned int w = a_width, h = a_height;
+	while (w > 1 || h > 1)
+	{
+		unsigned char* nextLevel = (unsigned char*)level + (size_t)w * h * 4;
+		unsigned int nextW = (w > 1) ? w / 2 : 1, nextH = (h > 1) ? h / 2 : 1;
+		unsigned int bandCount = (nextH + s_mipBandHeight - 1) / s_mipBandHeight;
+		ThreadPool::GetInstance()->ParallelFor(bandCount, [=](unsigned int a_band)
+		{
+			//each band maps to the matching region of the level above, filter taps outside the region still
+			//read the whole level so the bands join seamlessly
+			unsigned int y0 = a_band * s_mipBandHeight;
+			unsigned int y1 = std::min(y0 + s_mipBandHeight, nextH);
+			unsigned char* band = nextLevel + (size_t)y0 * nextW * 4;
+			stbir_resize_region(level, w, h, 0, band, nextW, y1 - y0, 0, STBIR_TYPE_UINT8, 4, alphaChannel, 0,
+				edge, edge, STBIR_FILTER_DEFAULT, STBIR_FILTER_DEFAULT, colourSpace, nullptr,
+				0.0f, (float)y0 / nextH, 1.0f, (float)y1 / nextH);
+
+			if (a_usage == NormalMap)
+			{
+				//filtering shortens the normals, bring them back to unit length
+				for (unsigned char* texel = band; texel < band + (size_t)(y1 - y0) * nextW * 4; texel += 4)
+				{
+					float x = texel[0] / 127.5f - 1.0f, y = texel[1] / 127.5f - 1.0f, z = texel[2] / 127.5f - 1.0f;
+					float length = sqrtf(x * x + y * y + z * z);
+					if (length > 0.0f)
+					{
+						texel[0] = (unsigned char)(std::min(std::max((x / length + 1.0f) * 127.5f + 0.5f, 0.0f), 255.0f));
+						texel[1] = (unsigned char)(std::min(std::max((y / length + 1.0f) * 127.5f + 0.5f, 0.0f), 255.0f));
+						texel[2] = (unsigned char)(std::min(std::max((z / length + 1.0f) * 127.5f + 0.5f, 0.0f), 255.0f));
+					}
+				}
+			}
+		});
+		level = nextLevel;
+		w = nextW;
+		h = nextH;
+	}
+}
+
+void TextureCompressor::Compress(const unsigned char* a_mips, const ImageLayout& a_layout, unsigned char* a_output)
+{
+	unsigned int w = a_layout.width, h = a_layout.height;
+	for (size_t i = 0; i < a_layout.levelSizes.size(); ++i)
+	{
+		CompressLevel(a_mips, w, h, a_layout.format, a_output);
+		a_mips += (size_t)w * h * 4;
+		a_output += a_layout.levelSizes[i];
+		w = (w > 1) ? w / 2 : 1;
+		h = (h > 1) ? h / 2 : 1;
+	}
+}
+
+void TextureCompressor::PackChannels(const unsigned char* a_mips, const ImageLayout& a_layout, unsigned char* a_output)
+{
+	//the texels are small enough that the whole chain is copied in one pass, each level follows the one before it
+	//every texel moves towards the start so the chain can be packed in place
+	size_t texelSize = getTexelSize(a_layout.format);
+	size_t texelCount = 0;
+	for (auto iter = a_layout.levelSizes.begin(); iter != a_layout.levelSizes.end(); ++iter)
+	{
+		texelCount += *iter / texelSize;
+	}
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		memmove(a_output + i * texelSize, a_mips + i * 4, texelSize);
+	}
+}
+
+void TextureCompressor::CompressLevel(const unsigned char* a_pixels, unsigned int a_width, unsigned int a_height, Format a_format, unsigned char* a_output)
+{
+	unsigned int blocksWide = (a_width + 3) / 4;
+	unsigned int blocksHigh = (a_height + 3) / 4;
+	size_t blockSize = getBlockSize(a_format);
+	ThreadPool::GetInstance()->ParallelFor(blocksHigh, [=](unsigned int a_blockRow)
+	{
+		unsigned char block[64];
+		unsigned char* output = a_output + (size_t)a_blockRow * blocksWide * blockSize;
+		for (unsigned int blockX = 0; blockX < blocksWide; ++blockX, output += blockSize)
+		{
+			//gather the 4x4 texels, edges of images that aren't a multiple of 4 repeat the last row or column
+			for (unsigned int i = 0; i < 16; ++i)
+			{
+				unsigned int x = std::min(blockX * 4 + (i & 3), a_width - 1);
+				unsigned int y = std::min(a_blockRow * 4 + (i >> 2), a_height - 1);
+				const unsigned char* texel = a_pixels + ((size_t)y * a_width + x) * 4;
+				switch (a_format)
+				{
+				case BC4: block[i] = texel[0]; break;
+				case BC5: block[i * 2] = texel[0]; block[i * 2 + 1] = texel[1]; break;
+				default: memcpy(block + i * 4, texel, 4); break;
+				}
+			}
+			switch (a_format)
+			{
+			case BC1: stb_compress_dxt_block(output, block, 0, STB_DXT_HIGHQUAL); break;
+			case BC3: stb_compress_dxt_block(output, block, 1, STB_DXT_HIGHQUAL); break;
+			case BC4: stb_compress_bc4_block(output, block); break;
+			case BC5: stb_compress_bc5_block(output, block); break;
+			default: break;
+			}
+		}
+	});
+}
+
+bool TextureCompressor::WriteCache(const std::string& a_filename, Usage a_usage, unsigned long long a_sourceHash, const ImageLayout& a_layout, const unsigned char* a_data)
+{
+	long long sourceSize = 0, sourceTime = 0;
+	if (!getSourceFileInfo(a_filename, sourceSize, sourceTime)) { return false; }
+
+	std::ofstream cacheFile(a_filename + ".texcache", std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!cacheFile.is_open())
+	{
+		std::cout << "Unable to write texture cache: " << a_filename << ".texcache" << std::endl;
+		return false;
+	}
+	unsigned int usage = a_usage, format = a_layout.format, levelCount = (unsigned int)a_layout.levelSizes.size();
+	size_t dataSize = 0;
+	for (auto iter = a_layout.levelSizes.begin(); iter != a_layout.levelSizes.end(); ++iter)
+	{
+		dataSize += *iter;
+	}
+	cacheFile.write(s_textureCacheMagic, sizeof(s_textureCacheMagic));
+	cacheFile.write((const char*)&sourceSize, sizeof(sourceSize));
+	cacheFile.write((const char*)&sourceTime, sizeof(sourceTime));
+	cacheFile.write((const char*)&a_sourceHash, sizeof(a_sourceHash));
+	cacheFile.write((const char*)&usage, sizeof(usage));
+	cacheFile.write((const char*)&format, sizeof(format));
+	cacheFile.write((const char*)&a_layout.width, sizeof(a_layout.width));
+	cacheFile.write((const char*)&a_layout.height, sizeof(a_layout.height));
+	cacheFile.write((const char*)&levelCount, sizeof(levelCount));
+	cacheFile.write((const char*)a_data, dataSize);
+	return cacheFile.good();
+}
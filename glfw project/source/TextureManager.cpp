@@ -1,5 +1,51 @@
 #include "TextureManager.h"
 #include "Texture.h"
+#include "MemoryTracker.h"
+#include "ThreadPool.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <glad/glad.h>
+
+//size of the persistently mapped staging buffer that decoded textures are written into
+static const size_t s_uploadBufferSize = 64 * 1024 * 1024;
+//when streaming, levels up to this size are always resident
+static const unsigned int s_residentLevelSize = 64;
+//updates a texture's larger levels stay resident after they were last needed
+static const unsigned int s_evictionDelay = 120;
+//default number of bytes of texture levels streamed in per frame
+static const size_t s_defaultStreamingBudget = 4 * 1024 * 1024;
+//default memory the textures can use before unreferenced ones are evicted
+static const size_t s_defaultMemoryBudget = 256 * 1024 * 1024;
+
+//the largest level that is always resident when streaming a texture of this size
+static unsigned int getResidentLevel(unsigned int a_width, unsigned int a_height)
+{
+	unsigned int level = 0;
+	for (unsigned int size = std::max(a_width, a_height); size > s_residentLevelSize; size /= 2)
+	{
+		++level;
+	}
+	return level;
+}
+
+//the layout of the levels of an image from a_level on, as an image of their own
+static TextureCompressor::ImageLayout getLevelLayout(const TextureCompressor::ImageLayout& a_layout, unsigned int a_level)
+{
+	TextureCompressor::ImageLayout layout;
+	layout.format = a_layout.format;
+	layout.width = std::max(a_layout.width >> a_level, 1u);
+	layout.height = std::max(a_layout.height >> a_level, 1u);
+	layout.levelSizes.assign(a_layout.levelSizes.begin() + a_level, a_layout.levelSizes.end());
+	layout.firstLevel = 0;
+	layout.endLevel = (unsigned int)layout.levelSizes.size();
+	return layout;
+}
 
 //set up static poitner for singleton object
 TextureManager* TextureManager::m_instance = nullptr;
@@ -31,50 +77,115 @@ void TextureManager::DestroyInstance()
 	}
 }
 
-TextureManager::TextureManager() : m_pTextureMap()
+TextureManager::TextureManager() : m_pTextureMap(), m_textureIDs(), m_textureCache(), m_fileSizes(), m_pathAliases(), m_sharedFiles(0),
+	m_memoryBudget(s_defaultMemoryBudget), m_memoryUsage(0), m_cacheHits(0), m_cacheMisses(0), m_evictions(0), m_pendingLoads(), m_uploadBuffer(), m_compressionEnabled(true),
+	m_streamingEnabled(true), m_streamingBudget(s_defaultStreamingBudget), m_textureArraysEnabled(true), m_textureArrays()
 {
-
+	m_uploadBuffer.Create(s_uploadBufferSize);
 }
 
 TextureManager::~TextureManager()
 {
+	//workers may still be writing into the upload buffer, wait for them before it is unmapped
+	for (auto iter = m_pendingLoads.begin(); iter != m_pendingLoads.end(); ++iter)
+	{
+		while ((*iter)->state == Decoding)
+		{
+			std::this_thread::yield();
+		}
+	}
+	m_pendingLoads.clear();
+	m_uploadBuffer.Destroy();
+	for (auto iter = m_textureArrays.begin(); iter != m_textureArrays.end(); ++iter)
+	{
+		delete *iter;
+	}
+	m_textureArrays.clear();
+	m_textureIDs.clear();
+	m_textureCache.clear();
+	m_fileSizes.clear();
+	m_pathAliases.clear();
 	m_pTextureMap.clear();
 }
 
 bool TextureManager::TetxureExists(const char* a_filename)
 {
-	auto dictIter = m_pTextureMap.find(a_filename);
-	return (dictIter != m_pTextureMap.end());
+	return (FindTexture(a_filename) != m_pTextureMap.end());
 }
 
-unsigned int TextureManager::LoadTexture(const char* a_filename)
+unsigned int TextureManager::LoadTexture(const char* a_filename, const char* a_pOwner, TextureCompressor::Usage a_usage)
 {
 	if (a_filename != nullptr)
 	{
-		auto dictionaryIter = m_pTextureMap.find(a_filename);
+		auto dictionaryIter = FindTexture(a_filename);
 		if (dictionaryIter != m_pTextureMap.end())
 		{
 			//texture is already in map, increment ref and return texture ID
-			TextureRef& texRef = (TextureRef&)(dictionaryIter->second);
-			++texRef.refCount;
-			return texRef.pTexture->GetTextureID();
+			++m_cacheHits;
+			return AddReference(dictionaryIter->second);
 		}
 		else
 		{
-			//texture is not in dictionary load in from file
-			Texture* pTexture = new Texture();
-			if (pTexture->Load(a_filename))
+			//texture is not in dictionary, check the file is a readable image before creating it
+			int width = 0, height = 0;
+			if (!Texture::GetImageInfo(a_filename, width, height))
+			{
+				std::cout << "Failed to open Image File: " << a_filename << std::endl;
+				return 0;
+			}
+
+			//a copy of an image that is already loaded under another name shares its texture
+			std::error_code error;
+			unsigned long long fileSize = (unsigned long long)std::filesystem::file_size(a_filename, error);
+			TextureCompressor::SourceFile source = { std::vector<unsigned char>(), 0, false };
+			if (!error)
 			{
-				//successful load
-				TextureRef texRef = { pTexture, 1 };
-				m_pTextureMap[a_filename] = texRef;
-				return pTexture->GetTextureID();
+				auto sharedIter = FindIdenticalTexture(a_filename, a_usage, fileSize, source);
+				if (sharedIter != m_pTextureMap.end())
+				{
+					++m_sharedFiles;
+					m_pathAliases[a_filename] = sharedIter->first;
+					sharedIter->second.aliases.push_back(a_filename);
+					std::cout << "Sharing identical image: " << a_filename << " with " << sharedIter->first << std::endl;
+					return AddReference(sharedIter->second);
+				}
 			}
-			else
+
+			//hand out a placeholder now and load the image in the background
+			Texture* pTexture = new Texture();
+			pTexture->CreatePlaceholder(a_filename, a_usage, m_compressionEnabled);
+			//the first model to load a texture is charged for its memory
+			++m_cacheMisses;
+			TextureRef texRef = { pTexture, 1, (a_pOwner != nullptr) ? a_pOwner : "Shared", UINT_MAX, 0, true, false, -1, -1, 0, 0, m_textureCache.end(),
+				fileSize, source.hash, source.hashed, std::vector<std::string>() };
+			dictionaryIter = m_pTextureMap.emplace(a_filename, texRef).first;
+			m_textureIDs[pTexture->GetTextureID()] = dictionaryIter;
+			if (!error)
 			{
-				delete pTexture;
-				return 0;
+				m_fileSizes.emplace(fileSize, dictionaryIter);
 			}
+			TrackMemoryUsage(dictionaryIter->second);
+
+			std::shared_ptr<PendingLoad> load = std::make_shared<PendingLoad>();
+			load->filename = a_filename;
+			load->pTexture = pTexture;
+			load->usage = a_usage;
+			load->compress = m_compressionEnabled;
+			load->width = width;
+			load->height = height;
+			//only the small levels are loaded to begin with when streaming, a texture array layer starts out with the same levels
+			load->firstLevel = m_streamingEnabled ? getResidentLevel(width, height) : 0;
+			load->endLevel = TextureCompressor::GetLevelCount(width, height);
+			load->stream = false;
+			//images that could never fit in the upload buffer are decoded into their own memory instead
+			load->bytes = TextureCompressor::GetMaxImageSize(width, height);
+			load->stagingOffset = 0;
+			load->pStaging = nullptr;
+			load->source = std::move(source);
+			load->state = Queued;
+			m_pendingLoads.push_back(load);
+			StartLoad(load);
+			return pTexture->GetTextureID();
 		}
 	}
 	return 0;
@@ -82,31 +193,536 @@ unsigned int TextureManager::LoadTexture(const char* a_filename)
 
 unsigned int TextureManager::GetTexture(const char* a_filename)
 {
-	auto dictIter = m_pTextureMap.find(a_filename);
+	auto dictIter = FindTexture(a_filename);
 	if (dictIter != m_pTextureMap.end())
 	{
-		TextureRef& texRef = (TextureRef&)(dictIter->second);
-		texRef.refCount++;
-		return texRef.pTexture->GetTextureID();
+		++m_cacheHits;
+		return AddReference(dictIter->second);
 	}
 	return 0;
 }
 
 void TextureManager::ReleaseTexture(unsigned int a_texture)
 {
+	auto idIter = m_textureIDs.find(a_texture);
+	if (idIter == m_textureIDs.end()) { return; }
+	TextureRef& texRef = idIter->second->second;
+	//pre decrement will happen prior to call to ==
+	if (texRef.refCount > 0 && --texRef.refCount == 0)
+	{
+		//keep the texture loaded in case it is used again, it is only deleted when its memory is needed
+		texRef.cacheEntry = m_textureCache.insert(m_textureCache.end(), idIter->second->first);
+		EvictTextures();
+	}
+}
+
+bool TextureManager::ReloadTexture(const std::string& a_filename)
+{
+	std::string filename = Utility::normalisePath(a_filename);
 	for (auto dictionaryIter = m_pTextureMap.begin(); dictionaryIter != m_pTextureMap.end(); ++dictionaryIter)
 	{
 		TextureRef& texRef = (TextureRef&)(dictionaryIter->second);
-		if (a_texture == texRef.pTexture->GetTextureID())
+		//a file that shared an identical texture no longer matches it, the materials using it keep the shared texture
+		//until they are reloaded and load the file on its own
+		for (auto aliasIter = texRef.aliases.begin(); aliasIter != texRef.aliases.end(); ++aliasIter)
+		{
+			if (Utility::normalisePath(*aliasIter) == filename)
+			{
+				std::cout << "Image no longer shares a texture, reload the model to see changes: " << *aliasIter << std::endl;
+				RemoveAlias(texRef, *aliasIter);
+				return false;
+			}
+		}
+
+		//textures are keyed by the name they were loaded with, which may be relative or use back slashes
+		if (Utility::normalisePath(dictionaryIter->first) == filename)
+		{
+			if (!texRef.pTexture->Reload()) { return false; }
+			//the contents have changed so files that were identical to it aren't anymore, the materials that already
+			//share the texture keep it but loading those files again gives them their own texture
+			while (!texRef.aliases.empty())
+			{
+				RemoveAlias(texRef, texRef.aliases.back());
+			}
+			texRef.hashed = false;
+			std::error_code error;
+			unsigned long long fileSize = (unsigned long long)std::filesystem::file_size(dictionaryIter->first, error);
+			SetFileSize(dictionaryIter, fileSize, !error);
+			//a reload makes every level resident, only the compressed cache is rewritten to stream them from later
+			texRef.streamable = texRef.pTexture->IsCompressed();
+			texRef.framesUnused = 0;
+			TrackMemoryUsage(texRef);
+			//the image may have changed size, so it is packed again rather than copied over its old layer
+			if (texRef.arrayIndex >= 0)
+			{
+				UnpackTexture(texRef, false);
+				PackTexture(texRef);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void TextureManager::Update()
+{
+	m_uploadBuffer.Update();
+
+	for (auto iter = m_pendingLoads.begin(); iter != m_pendingLoads.end(); )
+	{
+		PendingLoad& load = **iter;
+		if (load.state == Queued)
+		{
+			//a cancelled load that hasn't started yet can simply be dropped
+			if (load.pTexture == nullptr)
+			{
+				iter = m_pendingLoads.erase(iter);
+				continue;
+			}
+			StartLoad(*iter);
+		}
+		if (load.state == Decoded || load.state == Failed)
+		{
+			FinishLoad(load);
+			iter = m_pendingLoads.erase(iter);
+			continue;
+		}
+		++iter;
+	}
+
+	UpdateStreaming();
+	//streamed in levels may have taken the textures over the budget
+	EvictTextures();
+}
+
+void TextureManager::RequestTextureDetail(unsigned int a_texture, float a_uvPerPixel)
+{
+	TextureRef* pRef = FindTextureRef(a_texture);
+	if (pRef == nullptr) { return; }
+	//the GPU samples the level where one pixel covers about one texel
+	const TextureCompressor::ImageLayout& layout = pRef->pTexture->GetLayout();
+	float texelsPerPixel = std::max(layout.width, layout.height) * a_uvPerPixel;
+	unsigned int level = (texelsPerPixel > 1.0f) ? (unsigned int)log2f(texelsPerPixel) : 0;
+	pRef->requestedLevel = std::min(pRef->requestedLevel, level);
+}
+
+void TextureManager::UpdateStreaming()
+{
+	size_t budget = m_streamingBudget;
+	for (auto dictionaryIter = m_pTextureMap.begin(); dictionaryIter != m_pTextureMap.end(); ++dictionaryIter)
+	{
+		TextureRef& texRef = dictionaryIter->second;
+		unsigned int requestedLevel = texRef.requestedLevel;
+		texRef.requestedLevel = UINT_MAX;
+		if (texRef.loading) { continue; }
+		//textures are drawn on their own while texture arrays are turned off, and packed again once they are back on
+		if (!m_textureArraysEnabled && texRef.arrayIndex >= 0)
+		{
+			UnpackTexture(texRef, true);
+		}
+		else if (m_textureArraysEnabled && texRef.arrayIndex < 0)
+		{
+			PackTexture(texRef);
+		}
+		if (!texRef.streamable) { continue; }
+
+		//textures that weren't drawn only keep their small levels, with streaming off every level is wanted
+		//a packed texture is drawn from its array layer, so that is what streams rather than the texture itself
+		Texture* pTexture = texRef.pTexture;
+		const TextureCompressor::ImageLayout& layout = pTexture->GetLayout();
+		unsigned int residentLevel = getResidentLevel(layout.width, layout.height);
+		unsigned int targetLevel = m_streamingEnabled ? std::min(requestedLevel, residentLevel) : 0;
+		unsigned int firstLevel = (texRef.arrayIndex >= 0) ? texRef.arrayLevel : layout.firstLevel;
+		if (targetLevel < firstLevel)
 		{
-			//pre decrement will happen prior to call to ==
-			if (--texRef.refCount == 0)
+			texRef.framesUnused = 0;
+			if (budget == 0) { continue; }
+
+			std::shared_ptr<PendingLoad> load = std::make_shared<PendingLoad>();
+			load->filename = dictionaryIter->first;
+			load->pTexture = pTexture;
+			load->usage = pTexture->GetUsage();
+			load->compress = pTexture->IsCompressed();
+			load->width = layout.width;
+			load->height = layout.height;
+			load->firstLevel = targetLevel;
+			load->endLevel = firstLevel;
+			load->stream = true;
+			load->bytes = 0;
+			for (unsigned int level = targetLevel; level < firstLevel; ++level)
 			{
-				delete texRef.pTexture;
-				texRef.pTexture = nullptr;
-				m_pTextureMap.erase(dictionaryIter);
+				load->bytes += layout.levelSizes[level];
+			}
+			load->stagingOffset = 0;
+			load->pStaging = nullptr;
+			load->state = Queued;
+			m_pendingLoads.push_back(load);
+			StartLoad(load);
+			texRef.loading = true;
+			budget = (load->bytes < budget) ? budget - load->bytes : 0;
+		}
+		else if (targetLevel > firstLevel && m_streamingEnabled)
+		{
+			//wait before evicting so textures that are needed again shortly don't have to be streamed back in
+			if (++texRef.framesUnused >= s_evictionDelay)
+			{
+				if (texRef.arrayIndex >= 0)
+				{
+					RepackTexture(texRef, targetLevel, nullptr, nullptr);
+				}
+				else
+				{
+					pTexture->EvictLevels(targetLevel);
+					TrackMemoryUsage(texRef);
+				}
+				texRef.framesUnused = 0;
+			}
+		}
+		else
+		{
+			texRef.framesUnused = 0;
+		}
+	}
+}
+
+bool TextureManager::GetTextureLayer(unsigned int a_texture, unsigned int& a_arrayTexture, int& a_layer)
+{
+	TextureRef* pRef = FindTextureRef(a_texture);
+	if (pRef == nullptr || pRef->arrayIndex < 0) { return false; }
+	a_arrayTexture = m_textureArrays[pRef->arrayIndex]->GetTextureID();
+	a_layer = pRef->arrayLayer;
+	return true;
+}
+
+void TextureManager::PackTexture(TextureRef& a_texRef)
+{
+	//the resident levels have to run to the end of the chain, which they do for everything but an empty texture
+	const TextureCompressor::ImageLayout& layout = a_texRef.pTexture->GetLayout();
+	if (layout.firstLevel >= layout.endLevel || layout.endLevel != layout.levelSizes.size()) { return; }
+
+	a_texRef.arrayIndex = FindTextureArray(getLevelLayout(layout, layout.firstLevel));
+	a_texRef.arrayLayer = m_textureArrays[a_texRef.arrayIndex]->AddTexture(a_texRef.pTexture);
+	a_texRef.arrayLevel = layout.firstLevel;
+	//the layer is what gets drawn, so the texture's own copy of its larger levels is released. The small levels
+	//are kept so the texture stays complete, they cost little next to the rest
+	a_texRef.pTexture->EvictLevels(getResidentLevel(layout.width, layout.height));
+	TrackMemoryUsage(a_texRef);
+}
+
+void TextureManager::RepackTexture(TextureRef& a_texRef, unsigned int a_level, const TextureCompressor::ImageLayout* a_pLevels, const void* a_data)
+{
+	if (a_texRef.arrayIndex < 0) { return; }
+	int arrayIndex = FindTextureArray(getLevelLayout(a_texRef.pTexture->GetLayout(), a_level));
+	TextureArray* pArray = m_textureArrays[arrayIndex];
+	int layer = pArray->AddLayer();
+	pArray->CopyLayer(layer, *m_textureArrays[a_texRef.arrayIndex], a_texRef.arrayLayer);
+	if (a_pLevels != nullptr)
+	{
+		pArray->UploadLevels(layer, *a_pLevels, a_data);
+	}
+	ReleaseArrayLayer(a_texRef.arrayIndex, a_texRef.arrayLayer);
+	a_texRef.arrayIndex = arrayIndex;
+	a_texRef.arrayLayer = layer;
+	a_texRef.arrayLevel = a_level;
+	TrackMemoryUsage(a_texRef);
+}
+
+void TextureManager::UnpackTexture(TextureRef& a_texRef, bool a_restoreLevels)
+{
+	if (a_texRef.arrayIndex < 0) { return; }
+	if (a_restoreLevels)
+	{
+		m_textureArrays[a_texRef.arrayIndex]->CopyToTexture(a_texRef.arrayLayer, a_texRef.pTexture);
+	}
+	ReleaseArrayLayer(a_texRef.arrayIndex, a_texRef.arrayLayer);
+	a_texRef.arrayIndex = -1;
+	a_texRef.arrayLayer = -1;
+	TrackMemoryUsage(a_texRef);
+}
+
+int TextureManager::FindTextureArray(const TextureCompressor::ImageLayout& a_layout)
+{
+	//use the first array with a matching layout, otherwise create one in the first empty slot
+	for (unsigned int i = 0; i < m_textureArrays.size(); ++i)
+	{
+		if (m_textureArrays[i] != nullptr && m_textureArrays[i]->Matches(a_layout))
+		{
+			return (int)i;
+		}
+	}
+	auto freeSlot = std::find(m_textureArrays.begin(), m_textureArrays.end(), nullptr);
+	int arrayIndex = (int)(freeSlot - m_textureArrays.begin());
+	if (freeSlot == m_textureArrays.end())
+	{
+		m_textureArrays.push_back(nullptr);
+	}
+	m_textureArrays[arrayIndex] = new TextureArray(a_layout);
+	return arrayIndex;
+}
+
+void TextureManager::ReleaseArrayLayer(int a_arrayIndex, int a_layer)
+{
+	TextureArray* pArray = m_textureArrays[a_arrayIndex];
+	pArray->RemoveLayer(a_layer);
+	if (pArray->IsEmpty())
+	{
+		delete pArray;
+		m_textureArrays[a_arrayIndex] = nullptr;
+	}
+}
+
+void TextureManager::TrackMemoryUsage(TextureRef& a_texRef)
+{
+	size_t usage = a_texRef.pTexture->GetMemoryUsage();
+	if (a_texRef.arrayIndex >= 0)
+	{
+		usage += m_textureArrays[a_texRef.arrayIndex]->GetLayerSize();
+	}
+	MemoryTracker::Free(MemoryTracker::TextureData, a_texRef.owner, a_texRef.memoryUsage);
+	MemoryTracker::Allocate(MemoryTracker::TextureData, a_texRef.owner, usage);
+	m_memoryUsage = m_memoryUsage - a_texRef.memoryUsage + usage;
+	a_texRef.memoryUsage = usage;
+}
+
+unsigned int TextureManager::AddReference(TextureRef& a_texRef)
+{
+	if (a_texRef.refCount++ == 0)
+	{
+		m_textureCache.erase(a_texRef.cacheEntry);
+		a_texRef.cacheEntry = m_textureCache.end();
+	}
+	return a_texRef.pTexture->GetTextureID();
+}
+
+void TextureManager::EvictTextures()
+{
+	while (m_memoryBudget > 0 && m_memoryUsage > m_memoryBudget && !m_textureCache.empty())
+	{
+		DeleteTexture(m_pTextureMap.find(m_textureCache.front()));
+		++m_evictions;
+	}
+}
+
+void TextureManager::DeleteTexture(TextureMap::iterator a_iter)
+{
+	TextureRef& texRef = a_iter->second;
+	//a background load for this texture still completes but will no longer be uploaded
+	for (auto loadIter = m_pendingLoads.begin(); loadIter != m_pendingLoads.end(); ++loadIter)
+	{
+		if ((*loadIter)->pTexture == texRef.pTexture)
+		{
+			(*loadIter)->pTexture = nullptr;
+		}
+	}
+	if (texRef.refCount == 0)
+	{
+		m_textureCache.erase(texRef.cacheEntry);
+	}
+	UnpackTexture(texRef, false);
+	MemoryTracker::Free(MemoryTracker::TextureData, texRef.owner, texRef.memoryUsage);
+	m_memoryUsage -= texRef.memoryUsage;
+	m_textureIDs.erase(texRef.pTexture->GetTextureID());
+	while (!texRef.aliases.empty())
+	{
+		RemoveAlias(texRef, texRef.aliases.back());
+	}
+	SetFileSize(a_iter, 0, false);
+	delete texRef.pTexture;
+	texRef.pTexture = nullptr;
+	m_pTextureMap.erase(a_iter);
+}
+
+TextureManager::TextureStats TextureManager::GetStats() const
+{
+	TextureStats stats = { m_memoryUsage, m_memoryBudget, (unsigned int)m_pTextureMap.size(), (unsigned int)m_textureCache.size(),
+		m_cacheHits, m_cacheMisses, m_evictions, m_sharedFiles };
+	return stats;
+}
+
+TextureManager::TextureMap::iterator TextureManager::FindTexture(const std::string& a_filename)
+{
+	auto dictIter = m_pTextureMap.find(a_filename);
+	if (dictIter == m_pTextureMap.end())
+	{
+		auto aliasIter = m_pathAliases.find(a_filename);
+		if (aliasIter != m_pathAliases.end())
+		{
+			dictIter = m_pTextureMap.find(aliasIter->second);
+		}
+	}
+	return dictIter;
+}
+
+TextureManager::TextureMap::iterator TextureManager::FindIdenticalTexture(const std::string& a_filename, TextureCompressor::Usage a_usage,
+	unsigned long long a_fileSize, TextureCompressor::SourceFile& a_source)
+{
+	//most files have a size no other texture has, so they are never read here
+	for (auto sizeRange = m_fileSizes.equal_range(a_fileSize); sizeRange.first != sizeRange.second; ++sizeRange.first)
+	{
+		TextureRef& candidate = sizeRange.first->second->second;
+		//the same image used in a different way is prepared in a different format
+		if (candidate.pTexture->GetUsage() != a_usage || candidate.pTexture->IsCompressed() != m_compressionEnabled) { continue; }
+		if (!a_source.hashed)
+		{
+			if (!Texture::ReadImageFile(a_filename, a_source.data))
+			{
+				a_source.data.clear();
 				break;
 			}
+			a_source.hash = Utility::hashBytes(a_source.data.data(), a_source.data.size());
+			a_source.hashed = true;
+		}
+		if (!candidate.hashed)
+		{
+			candidate.hashed = Utility::hashFile(sizeRange.first->second->first, candidate.contentHash);
+		}
+		if (candidate.hashed && candidate.contentHash == a_source.hash)
+		{
+			return sizeRange.first->second;
+		}
+	}
+	return m_pTextureMap.end();
+}
+
+void TextureManager::SetFileSize(TextureMap::iterator a_iter, unsigned long long a_fileSize, bool a_known)
+{
+	for (auto sizeRange = m_fileSizes.equal_range(a_iter->second.fileSize); sizeRange.first != sizeRange.second; ++sizeRange.first)
+	{
+		if (sizeRange.first->second == a_iter)
+		{
+			m_fileSizes.erase(sizeRange.first);
+			break;
 		}
 	}
+	a_iter->second.fileSize = a_fileSize;
+	if (a_known)
+	{
+		m_fileSizes.emplace(a_fileSize, a_iter);
+	}
+}
+
+void TextureManager::RemoveAlias(TextureRef& a_texRef, const std::string& a_alias)
+{
+	m_pathAliases.erase(a_alias);
+	a_texRef.aliases.erase(std::find(a_texRef.aliases.begin(), a_texRef.aliases.end(), a_alias));
+}
+
+TextureManager::TextureRef* TextureManager::FindTextureRef(const Texture* a_pTexture)
+{
+	return FindTextureRef(a_pTexture->GetTextureID());
+}
+
+TextureManager::TextureRef* TextureManager::FindTextureRef(unsigned int a_texture)
+{
+	auto idIter = m_textureIDs.find(a_texture);
+	return (idIter != m_textureIDs.end()) ? &idIter->second->second : nullptr;
+}
+
+bool TextureManager::StartLoad(std::shared_ptr<PendingLoad> a_load)
+{
+	//images that could never fit in the upload buffer are decoded into their own memory instead
+	if (a_load->bytes <= m_uploadBuffer.GetCapacity())
+	{
+		if (!m_uploadBuffer.Allocate(a_load->bytes, a_load->stagingOffset, a_load->pStaging))
+		{
+			return false;
+		}
+	}
+
+	a_load->state = Decoding;
+	ThreadPool::GetInstance()->Submit([a_load]()
+	{
+		unsigned char* output = (unsigned char*)a_load->pStaging;
+		if (output == nullptr)
+		{
+			a_load->pixels.resize(a_load->bytes);
+			output = a_load->pixels.data();
+		}
+		//on failure the texture keeps its placeholder, or the levels it already has when streaming
+		bool prepared = a_load->stream ?
+			TextureCompressor::ReadCachedLevels(a_load->filename, a_load->usage, a_load->compress, a_load->width, a_load->height,
+				a_load->firstLevel, a_load->endLevel, a_load->layout, output) :
+			TextureCompressor::PrepareImage(a_load->filename, a_load->usage, a_load->compress, a_load->width, a_load->height,
+				a_load->firstLevel, a_load->layout, output, &a_load->source);
+		//only the hash is kept once the image is decoded
+		std::vector<unsigned char>().swap(a_load->source.data);
+		a_load->state = prepared ? Decoded : Failed;
+	});
+	return true;
+}
+
+void TextureManager::FinishLoad(PendingLoad& a_load)
+{
+	TextureRef* pRef = (a_load.pTexture != nullptr) ? FindTextureRef(a_load.pTexture) : nullptr;
+	if (pRef != nullptr)
+	{
+		pRef->loading = false;
+	}
+
+	//streamed levels only fit if the texture, or the array layer it is drawn from, still starts at the level they run up to
+	bool upload = (pRef != nullptr && a_load.state == Decoded);
+	if (upload && a_load.stream)
+	{
+		const TextureCompressor::ImageLayout& layout = a_load.pTexture->GetLayout();
+		unsigned int firstLevel = (pRef->arrayIndex >= 0) ? pRef->arrayLevel : layout.firstLevel;
+		upload = (firstLevel == a_load.layout.endLevel && layout.format == a_load.layout.format);
+	}
+
+	if (upload)
+	{
+		//the upload reads from the staging buffer asynchronously, the source pointer is an offset into it
+		const void* data = a_load.pixels.data();
+		if (a_load.pStaging != nullptr)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffer.GetBufferID());
+			data = (const void*)a_load.stagingOffset;
+		}
+		if (a_load.stream && pRef->arrayIndex >= 0)
+		{
+			RepackTexture(*pRef, a_load.layout.firstLevel, &a_load.layout, data);
+		}
+		else
+		{
+			a_load.pTexture->Upload(a_load.layout, data);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		//the first model to load a texture is charged for its memory
+		TrackMemoryUsage(*pRef);
+		if (!a_load.stream)
+		{
+			//textures that were loaded without their large levels have them cached to stream from, compressed textures
+			//always have their whole chain cached
+			pRef->streamable = (a_load.layout.firstLevel > 0 || a_load.pTexture->IsCompressed());
+			//the file was hashed as it was decoded, so it won't be read again to compare it with later files
+			if (!pRef->hashed && a_load.source.hashed)
+			{
+				pRef->contentHash = a_load.source.hash;
+				pRef->hashed = true;
+			}
+			std::cout << "Successfully loaded Image File: " << a_load.filename << std::endl;
+		}
+		//textures are packed with the levels they have, a packed texture's layer follows the levels streamed for it
+		if (m_textureArraysEnabled && pRef->arrayIndex < 0)
+		{
+			PackTexture(*pRef);
+		}
+	}
+	else if (a_load.state == Failed)
+	{
+		if (a_load.stream)
+		{
+			//the cache has gone, keep the levels that are resident rather than trying again every frame
+			if (pRef != nullptr) { pRef->streamable = false; }
+			std::cout << "Unable to stream texture levels: " << a_load.filename << std::endl;
+		}
+		else
+		{
+			std::cout << "Failed to open Image File: " << a_load.filename << std::endl;
+		}
+	}
+
+	if (a_load.pStaging != nullptr)
+	{
+		m_uploadBuffer.Release(a_load.stagingOffset);
+	}
 }
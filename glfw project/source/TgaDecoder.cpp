@@ -0,0 +1,202 @@
+#include "TgaDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TGA_DECODER_SSE2
+#endif
+
+//the image types this decoder handles, colour mapped images are left to stb_image
+enum TgaImageType
+{
+	TrueColour = 2,
+	Greyscale = 3,
+	TrueColourRLE = 10,
+	GreyscaleRLE = 11
+};
+
+static const size_t s_headerSize = 18;
+//image descriptor bits, the origin is bottom left unless the top bit is set
+static const unsigned char s_rightToLeftBit = 0x10;
+static const unsigned char s_topToBottomBit = 0x20;
+
+typedef struct TgaHeader
+{
+	unsigned int imageType;
+	unsigned int width;
+	unsigned int height;
+	unsigned int pixelSize;	//bytes per pixel
+	bool topToBottom;
+	size_t dataOffset;		//offset of the pixel data, after the image ID and colour map
+}TgaHeader;
+
+static bool readHeader(const unsigned char* a_data, size_t a_size, TgaHeader& a_header)
+{
+	if (a_data == nullptr || a_size < s_headerSize) { return false; }
+	unsigned int idLength = a_data[0];
+	unsigned int colourMapType = a_data[1];
+	unsigned int colourMapLength = a_data[5] | (a_data[6] << 8);
+	unsigned int colourMapBits = a_data[7];
+	unsigned int bitsPerPixel = a_data[16];
+	unsigned char descriptor = a_data[17];
+	a_header.imageType = a_data[2];
+	a_header.width = a_data[12] | (a_data[13] << 8);
+	a_header.height = a_data[14] | (a_data[15] << 8);
+	a_header.pixelSize = bitsPerPixel / 8;
+	a_header.topToBottom = (descriptor & s_topToBottomBit) != 0;
+	//true colour images can still carry a colour map, it is skipped
+	a_header.dataOffset = s_headerSize + idLength + (colourMapType == 1 ? (size_t)colourMapLength * ((colourMapBits + 7) / 8) : 0);
+
+	bool trueColour = (a_header.imageType == TrueColour || a_header.imageType == TrueColourRLE) && (bitsPerPixel == 24 || bitsPerPixel == 32);
+	bool greyscale = (a_header.imageType == Greyscale || a_header.imageType == GreyscaleRLE) && bitsPerPixel == 8;
+	return (trueColour || greyscale) && colourMapType <= 1 && (descriptor & s_rightToLeftBit) == 0 &&
+		a_header.width > 0 && a_header.height > 0 && a_header.dataOffset <= a_size;
+}
+
+//write a_count copies of one RGBA8 pixel
+static void fillPixels(unsigned char* a_output, const unsigned char* a_pixel, unsigned int a_count)
+{
+	unsigned int value = 0;
+	memcpy(&value, a_pixel, 4);
+	unsigned int i = 0;
+#ifdef TGA_DECODER_SSE2
+	__m128i pixels = _mm_set1_epi32((int)value);
+	for (; i + 4 <= a_count; i += 4)
+	{
+		_mm_storeu_si128((__m128i*)(a_output + i * 4), pixels);
+	}
+#endif
+	for (; i < a_count; ++i)
+	{
+		memcpy(a_output + i * 4, &value, 4);
+	}
+}
+
+bool TgaDecoder::GetInfo(const unsigned char* a_data, size_t a_size, unsigned int& a_width, unsigned int& a_height)
+{
+	TgaHeader header;
+	if (!readHeader(a_data, a_size, header)) { return false; }
+	a_width = header.width;
+	a_height = header.height;
+	return true;
+}
+
+bool TgaDecoder::Decode(const unsigned char* a_data, size_t a_size, bool a_flipVertically, unsigned char* a_output)
+{
+	TgaHeader header;
+	if (!readHeader(a_data, a_size, header)) { return false; }
+
+	//rows are stored from the bottom unless the top to bottom bit is set, rather than flipping the image afterwards
+	//each row is written straight to where it belongs, which is in file order when those two disagree
+	size_t rowSize = (size_t)header.width * 4;
+	bool fileOrder = (header.topToBottom != a_flipVertically);
+	unsigned char* row = fileOrder ? a_output : a_output + rowSize * (header.height - 1);
+	std::ptrdiff_t rowStep = fileOrder ? (std::ptrdiff_t)rowSize : -(std::ptrdiff_t)rowSize;
+
+	const unsigned char* source = a_data + header.dataOffset;
+	const unsigned char* end = a_data + a_size;
+	unsigned int pixelSize = header.pixelSize;
+	if (header.imageType == TrueColour || header.imageType == Greyscale)
+	{
+		if ((size_t)(end - source) < (size_t)header.width * header.height * pixelSize) { return false; }
+		for (unsigned int y = 0; y < header.height; ++y, row += rowStep, source += (size_t)header.width * pixelSize)
+		{
+			ConvertPixels(source, pixelSize, header.width, row);
+		}
+		return true;
+	}
+
+	//run length encoded packets can run across the end of a row, so each packet is written in pieces that fit
+	unsigned int x = 0, y = 0;
+	while (y < header.height)
+	{
+		if (source >= end) { return false; }
+		unsigned char packet = *source++;
+		unsigned int count = (packet & 0x7F) + 1;
+		if (packet & 0x80)
+		{
+			//a run of one repeated pixel
+			if ((size_t)(end - source) < pixelSize) { return false; }
+			unsigned char pixel[4];
+			ConvertPixels(source, pixelSize, 1, pixel);
+			source += pixelSize;
+			while (count > 0 && y < header.height)
+			{
+				unsigned int span = std::min(count, header.width - x);
+				fillPixels(row + (size_t)x * 4, pixel, span);
+				count -= span;
+				x += span;
+				if (x == header.width) { x = 0; ++y; row += rowStep; }
+			}
+		}
+		else
+		{
+			//a packet of raw pixels
+			if ((size_t)(end - source) < (size_t)count * pixelSize) { return false; }
+			while (count > 0 && y < header.height)
+			{
+				unsigned int span = std::min(count, header.width - x);
+				ConvertPixels(source, pixelSize, span, row + (size_t)x * 4);
+				source += (size_t)span * pixelSize;
+				count -= span;
+				x += span;
+				if (x == header.width) { x = 0; ++y; row += rowStep; }
+			}
+		}
+	}
+	return true;
+}
+
+void TgaDecoder::ConvertPixels(const unsigned char* a_source, unsigned int a_pixelSize, unsigned int a_count, unsigned char* a_output)
+{
+	unsigned int i = 0;
+	switch (a_pixelSize)
+	{
+	case 4:
+	{
+		//BGRA to RGBA swaps the red and blue bytes of each pixel and leaves green and alpha where they are
+#ifdef TGA_DECODER_SSE2
+		const __m128i redBlueMask = _mm_set1_epi32(0x00FF00FF);
+		for (; i + 4 <= a_count; i += 4)
+		{
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(a_source + i * 4));
+			__m128i redBlue = _mm_and_si128(pixels, redBlueMask);
+			__m128i greenAlpha = _mm_andnot_si128(redBlueMask, pixels);
+			redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+			_mm_storeu_si128((__m128i*)(a_output + i * 4), _mm_or_si128(redBlue, greenAlpha));
+		}
+#endif
+		for (; i < a_count; ++i)
+		{
+			const unsigned char* pixel = a_source + i * 4;
+			unsigned char* output = a_output + i * 4;
+			output[0] = pixel[2];
+			output[1] = pixel[1];
+			output[2] = pixel[0];
+			output[3] = pixel[3];
+		}
+		break;
+	}
+	case 3:
+		for (; i < a_count; ++i)
+		{
+			const unsigned char* pixel = a_source + i * 3;
+			unsigned char* output = a_output + i * 4;
+			output[0] = pixel[2];
+			output[1] = pixel[1];
+			output[2] = pixel[0];
+			output[3] = 255;
+		}
+		break;
+	default:
+		for (; i < a_count; ++i)
+		{
+			unsigned char* output = a_output + i * 4;
+			output[0] = output[1] = output[2] = a_source[i];
+			output[3] = 255;
+		}
+		break;
+	}
+}
@@ -0,0 +1,122 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+
+//set up static pointer for singleton object
+ThreadPool* ThreadPool::m_instance = nullptr;
+
+ThreadPool* ThreadPool::CreateInstance()
+{
+	if (m_instance == nullptr)
+	{
+		m_instance = new ThreadPool();
+	}
+	return m_instance;
+}
+
+ThreadPool* ThreadPool::GetInstance()
+{
+	if (m_instance == nullptr)
+	{
+		return ThreadPool::CreateInstance();
+	}
+	return m_instance;
+}
+
+void ThreadPool::DestroyInstance()
+{
+	if (m_instance != nullptr)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+ThreadPool::ThreadPool() : m_running(true)
+{
+	//leave one hardware thread for the main thread, but always have at least one worker
+	unsigned int workerCount = std::thread::hardware_concurrency();
+	workerCount = (workerCount > 1) ? workerCount - 1 : 1;
+	for (unsigned int i = 0; i < workerCount; ++i)
+	{
+		m_workers.push_back(std::thread(&ThreadPool::WorkerThread, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	//let the workers finish the jobs already queued, then wait for them to exit
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_jobAvailable.notify_all();
+	for (auto iter = m_workers.begin(); iter != m_workers.end(); ++iter)
+	{
+		iter->join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> a_job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(a_job));
+	}
+	m_jobAvailable.notify_one();
+}
+
+void ThreadPool::ParallelFor(unsigned int a_count, const std::function<void(unsigned int)>& a_function)
+{
+	//indices are claimed from a shared counter, helper jobs that start after every index has been claimed
+	//return without touching the function so the state only has to outlive this call through the shared pointer
+	struct ParallelState
+	{
+		std::function<void(unsigned int)> function;
+		unsigned int count;
+		std::atomic<unsigned int> next;
+		std::atomic<unsigned int> completed;
+	};
+	std::shared_ptr<ParallelState> state = std::make_shared<ParallelState>();
+	state->function = a_function;
+	state->count = a_count;
+	state->next = 0;
+	state->completed = 0;
+
+	auto runIndices = [state]()
+	{
+		for (unsigned int i = state->next++; i < state->count; i = state->next++)
+		{
+			state->function(i);
+			++state->completed;
+		}
+	};
+	unsigned int helperCount = (a_count > 1) ? std::min(a_count - 1, (unsigned int)m_workers.size()) : 0;
+	for (unsigned int i = 0; i < helperCount; ++i)
+	{
+		Submit(runIndices);
+	}
+	runIndices();
+	//wait for the indices still being run by the helpers
+	while (state->completed < a_count)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void ThreadPool::WorkerThread()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this]() { return !m_jobs.empty() || !m_running; });
+			if (m_jobs.empty()) { return; }
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+		job();
+	}
+}
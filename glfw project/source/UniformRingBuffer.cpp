@@ -0,0 +1,126 @@
+#include "UniformRingBuffer.h"
+#include "MemoryTracker.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+UniformRingBuffer::UniformRingBuffer() : m_bufferID(0), m_pData(nullptr), m_frameCapacity(0), m_alignment(256), m_frame(0), m_head(0), m_fences()
+{
+
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+	Destroy();
+}
+
+bool UniformRingBuffer::Create(size_t a_frameCapacity, unsigned int a_frameCount)
+{
+	Destroy();
+	//both alignments are powers of two, so the larger one satisfies either kind of block
+	int uniformAlignment = 0, storageAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	int alignment = (uniformAlignment > storageAlignment) ? uniformAlignment : storageAlignment;
+	m_alignment = (alignment > 0) ? (size_t)alignment : 256;
+	a_frameCapacity = (a_frameCapacity + m_alignment - 1) / m_alignment * m_alignment;
+
+	//a persistent, coherent mapping means each frame's data is written without mapping or updating the buffer
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	size_t capacity = a_frameCapacity * a_frameCount;
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferStorage(GL_UNIFORM_BUFFER, capacity, nullptr, flags);
+	m_pData = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, capacity, flags);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	if (m_pData == nullptr)
+	{
+		std::cout << "Unable to map uniform ring buffer" << std::endl;
+		Destroy();
+		return false;
+	}
+	m_frameCapacity = a_frameCapacity;
+	m_fences.assign(a_frameCount, nullptr);
+	m_frame = 0;
+	m_head = 0;
+	MemoryTracker::Allocate(MemoryTracker::BufferData, "Uniforms", capacity);
+	return true;
+}
+
+void UniformRingBuffer::Destroy()
+{
+	for (auto iter = m_fences.begin(); iter != m_fences.end(); ++iter)
+	{
+		if (*iter != nullptr)
+		{
+			glDeleteSync((GLsync)*iter);
+		}
+	}
+	if (m_bufferID != 0)
+	{
+		if (m_pData != nullptr)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			MemoryTracker::Free(MemoryTracker::BufferData, "Uniforms", m_frameCapacity * m_fences.size());
+		}
+		glDeleteBuffers(1, &m_bufferID);
+	}
+	m_fences.clear();
+	m_bufferID = 0;
+	m_pData = nullptr;
+	m_frameCapacity = 0;
+	m_head = 0;
+}
+
+size_t UniformRingBuffer::GetAlignedSize(size_t a_bytes) const
+{
+	return (a_bytes + m_alignment - 1) / m_alignment * m_alignment;
+}
+
+void UniformRingBuffer::BeginFrame(size_t a_bytes)
+{
+	if (a_bytes > m_frameCapacity)
+	{
+		//the GL keeps the old buffer alive until the frames reading it have finished, so it can be replaced straight away
+		unsigned int frameCount = m_fences.empty() ? 3 : (unsigned int)m_fences.size();
+		size_t capacity = m_frameCapacity * 2;
+		Create(capacity > a_bytes ? capacity : a_bytes, frameCount);
+	}
+	else if (!m_fences.empty())
+	{
+		m_frame = (m_frame + 1) % m_fences.size();
+	}
+	m_head = 0;
+	if (m_fences.empty() || m_fences[m_frame] == nullptr) { return; }
+
+	//with a region per frame in flight this only waits when the CPU is that many frames ahead of the GPU
+	GLsync fence = (GLsync)m_fences[m_frame];
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(fence, 0, 1000000);
+	}
+	glDeleteSync(fence);
+	m_fences[m_frame] = nullptr;
+}
+
+void* UniformRingBuffer::Allocate(size_t a_bytes, size_t& a_offset)
+{
+	size_t bytes = GetAlignedSize(a_bytes);
+	if (m_pData == nullptr || m_head + bytes > m_frameCapacity) { return nullptr; }
+	a_offset = m_frame * m_frameCapacity + m_head;
+	m_head += bytes;
+	return m_pData + a_offset;
+}
+
+void UniformRingBuffer::EndFrame()
+{
+	if (m_fences.empty()) { return; }
+	if (m_fences[m_frame] != nullptr)
+	{
+		glDeleteSync((GLsync)m_fences[m_frame]);
+	}
+	m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
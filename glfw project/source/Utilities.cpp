@@ -1,14 +1,33 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
 #include "Utilities.h"
 
+//multipliers for the hash, large odd constants with well mixed bits (the primes used by xxHash64)
+static const unsigned long long s_hashPrime1 = 0x9E3779B185EBCA87ull;
+static const unsigned long long s_hashPrime2 = 0xC2B2AE3D27D4EB4Full;
+static const unsigned long long s_hashPrime3 = 0x165667B19E3779F9ull;
+
+static unsigned long long rotateLeft(unsigned long long a_value, int a_bits)
+{
+	return (a_value << a_bits) | (a_value >> (64 - a_bits));
+}
+
+//mix one 8 byte word into a hash lane
+static unsigned long long hashRound(unsigned long long a_lane, unsigned long long a_word)
+{
+	return rotateLeft(a_lane + a_word * s_hashPrime2, 31) * s_hashPrime1;
+}
+
 static double s_prevTime = 0;
 static float s_totalTime = 0;
 static float s_deltaTime = 0;
@@ -69,6 +88,66 @@ char* Utility::fileToBuffer(const char* a_sPath)
 	return nullptr;
 }
 
+std::string Utility::normalisePath(const std::string& a_path)
+{
+	std::error_code error;
+	std::filesystem::path path = std::filesystem::weakly_canonical(std::filesystem::absolute(a_path, error), error);
+	return path.lexically_normal().generic_string();
+}
+
+unsigned long long Utility::hashBytes(const void* a_data, size_t a_size, unsigned long long a_seed)
+{
+	const unsigned char* data = (const unsigned char*)a_data;
+	const unsigned char* end = data + a_size;
+	unsigned long long word = 0;
+	unsigned long long hash = a_seed + s_hashPrime3 + a_size;
+	if (a_size >= 32)
+	{
+		//four independent lanes keep the multipliers busy, they are folded together at the end
+		unsigned long long lanes[4] = { a_seed + s_hashPrime1 + s_hashPrime2, a_seed + s_hashPrime2, a_seed, a_seed - s_hashPrime1 };
+		for (; data + 32 <= end; data += 32)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				memcpy(&word, data + i * 8, 8);
+				lanes[i] = hashRound(lanes[i], word);
+			}
+		}
+		hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18) + a_size;
+		for (int i = 0; i < 4; ++i)
+		{
+			hash = (hash ^ hashRound(0, lanes[i])) * s_hashPrime1 + s_hashPrime3;
+		}
+	}
+	for (; data + 8 <= end; data += 8)
+	{
+		memcpy(&word, data, 8);
+		hash = rotateLeft(hash ^ hashRound(0, word), 27) * s_hashPrime1 + s_hashPrime3;
+	}
+	for (; data < end; ++data)
+	{
+		hash = rotateLeft(hash ^ (*data * s_hashPrime3), 11) * s_hashPrime1;
+	}
+	//final avalanche so every input bit affects every output bit
+	hash ^= hash >> 33;
+	hash *= s_hashPrime2;
+	hash ^= hash >> 29;
+	hash *= s_hashPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+bool Utility::hashFile(const std::string& a_path, unsigned long long& a_hash)
+{
+	std::ifstream file(a_path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+	if (!file.is_open()) { return false; }
+	std::vector<char> data((size_t)file.tellg());
+	file.seekg(0);
+	if (!file.read(data.data(), data.size())) { return false; }
+	a_hash = hashBytes(data.data(), data.size());
+	return true;
+}
+
 void Utility::freeMovement(glm::mat4& a_transform, float a_deltaTime, float a_speed, const glm::vec3& a_up)
 {
 	//get the current window context
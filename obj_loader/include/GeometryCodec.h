@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+class OBJVertex;
+
+//a compression codec for OBJMesh vertex and index streams, used for the on-disk geometry cache
+//vertex attributes are quantised over the range of each component (16 bits, 12 for normals), then every stream
+//(each position, normal and uv component and the indices) is delta and zigzag encoded and bit packed in
+//blocks of 128 values, with the bit width chosen per block. Vertex components are stored block by block
+//so a block of vertices can be decoded while it is still in cache. The packed layout interleaves 4 lanes
+//so a block can be unpacked with SSE2 one vector at a time
+class GeometryCodec
+{
+public:
+	//append the encoded vertices to a_output
+	static void encodeVertices(const OBJVertex* a_vertices, unsigned int a_count, std::vector<unsigned char>& a_output);
+	//append the encoded indices to a_output, a_indexSize is the size in bytes of each index (2 or 4)
+	static void encodeIndices(const void* a_indices, unsigned int a_count, unsigned int a_indexSize, std::vector<unsigned char>& a_output);
+
+	//decode data written by the encode functions, a_data is advanced past the data read
+	//these return false if the data is truncated or corrupt, including indices that are not below a_vertexCount
+	static bool decodeVertices(const unsigned char*& a_data, const unsigned char* a_end, std::vector<OBJVertex>& a_vertices);
+	static bool decodeIndices(const unsigned char*& a_data, const unsigned char* a_end, unsigned int a_vertexCount, std::vector<unsigned int>& a_indices);
+
+private:
+	//number of values packed together with a single bit width
+	static const unsigned int BlockSize = 128;
+
+	//delta, zigzag and bit pack up to BlockSize values, a_previous carries the last value between blocks
+	static void encodeBlock(const unsigned int* a_values, unsigned int a_count, unsigned int& a_previous, std::vector<unsigned char>& a_output);
+	//decode a full block of BlockSize values into a_values
+	static bool decodeBlock(const unsigned char*& a_data, const unsigned char* a_end, unsigned int& a_previous, unsigned int* a_values);
+
+	static void packBlock(const unsigned int* a_values, unsigned int a_bits, unsigned char* a_output);
+	static void unpackBlock(const unsigned char* a_input, unsigned int a_bits, unsigned int* a_values);
+};
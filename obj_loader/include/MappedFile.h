@@ -0,0 +1,145 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+
+//a temporary file on disk that is memory-mapped into the address space of the process
+//the operating system pages the contents in and out as they are touched, so data far larger than
+//physical memory can be worked with. The backing file is deleted when the mapping is closed
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	//create a new, empty backing file in the given directory (or the system temp directory if empty)
+	bool open(const std::string& a_directory);
+	//unmap and delete the backing file
+	void close();
+	//grow or shrink the backing file and remap it, existing contents are preserved
+	bool resize(size_t a_bytes);
+	//drop any resident pages from the process working set, contents are kept in the backing file
+	//returns false if the file could not be mapped again afterwards
+	bool trim();
+
+	bool isOpen() const { return m_open; }
+	void* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	//copying a mapping would double free the file handles
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//a_address asks for the view to be placed at a particular address, used to keep pointers valid across a trim
+	bool map(void* a_address = nullptr);
+	void unmap();
+
+	bool m_open;
+	void* m_data;
+	size_t m_size;
+#ifdef _WIN32
+	//file and file mapping HANDLEs, stored as void* to keep windows.h out of this header
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#else
+	int m_fileDescriptor;
+#endif
+};
+
+//a growable array of plain data that lives on the heap by default, or in a MappedFile once spilled to disk
+//only suitable for types that can be safely copied with memcpy
+template<typename T>
+class MappedArray
+{
+public:
+	MappedArray() : m_file(), m_heap(nullptr), m_size(0), m_capacity(0) {}
+	~MappedArray() { clear(); }
+
+	//move the array contents into a disk backed mapping, must be called while the array is empty
+	bool spillToDisk(const std::string& a_directory);
+	bool isSpilled() const { return m_file.isOpen(); }
+
+	//these return false if a spilled array's backing file could not be grown or mapped, the array is unusable after that
+	bool reserve(size_t a_capacity);
+	bool push_back(const T& a_value) { return append(&a_value, 1); }
+	bool append(const T* a_values, size_t a_count);
+	void clear();
+	//release resident pages of a spilled array back to the operating system
+	bool trim() { return !isSpilled() || m_file.trim(); }
+
+	T* data() { return isSpilled() ? (T*)m_file.data() : m_heap; }
+	const T* data() const { return isSpilled() ? (const T*)m_file.data() : m_heap; }
+	T& operator[](size_t a_index) { return data()[a_index]; }
+	const T& operator[](size_t a_index) const { return data()[a_index]; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+private:
+	MappedArray(const MappedArray&) = delete;
+	MappedArray& operator=(const MappedArray&) = delete;
+
+	MappedFile m_file;
+	T* m_heap;
+	size_t m_size;
+	size_t m_capacity;
+};
+
+template<typename T>
+bool MappedArray<T>::spillToDisk(const std::string& a_directory)
+{
+	if (m_size != 0 || isSpilled()) { return false; }
+	delete[] (unsigned char*)m_heap;
+	m_heap = nullptr;
+	m_capacity = 0;
+	return m_file.open(a_directory);
+}
+
+template<typename T>
+bool MappedArray<T>::reserve(size_t a_capacity)
+{
+	if (a_capacity <= m_capacity) { return true; }
+	if (isSpilled())
+	{
+		if (!m_file.resize(a_capacity * sizeof(T))) { return false; }
+	}
+	else
+	{
+		//raw storage so element constructors are not run for the unused capacity
+		T* heap = (T*)new unsigned char[a_capacity * sizeof(T)];
+		if (m_heap != nullptr)
+		{
+			memcpy((void*)heap, (const void*)m_heap, m_size * sizeof(T));
+			delete[] (unsigned char*)m_heap;
+		}
+		m_heap = heap;
+	}
+	m_capacity = a_capacity;
+	return true;
+}
+
+template<typename T>
+bool MappedArray<T>::append(const T* a_values, size_t a_count)
+{
+	if (m_size + a_count > m_capacity)
+	{
+		//grow geometrically so remapping the backing file stays infrequent
+		size_t capacity = (m_capacity < 1024) ? 1024 : m_capacity * 2;
+		while (capacity < m_size + a_count) { capacity *= 2; }
+		if (!reserve(capacity)) { return false; }
+	}
+	if (a_count == 0) { return true; }
+	memcpy((void*)(data() + m_size), (const void*)a_values, a_count * sizeof(T));
+	m_size += a_count;
+	return true;
+}
+
+template<typename T>
+void MappedArray<T>::clear()
+{
+	delete[] (unsigned char*)m_heap;
+	m_heap = nullptr;
+	m_file.close();
+	m_size = 0;
+	m_capacity = 0;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "MappedFile.h"
+
 #include <glm/glm.hpp>
 
 #include <vector>
@@ -54,7 +56,7 @@ inline bool OBJVertex::operator < (const OBJVertex& a_rhs) const
 class OBJMaterial
 {
 public:
-	OBJMaterial() : name(), kA(0.0f), kD(0.0f), kS(0.0f) {};
+	OBJMaterial() : name(), kA(0.0f), kD(0.0f), kS(0.0f), uniformBufferID(0), uniformOffset(0) {};
 	~OBJMaterial() {};
 
 	std::string name;
@@ -75,8 +77,24 @@ public:
 	//texture will have filenames for loading, once loading ID's stored in ID array
 	std::string textureFileNames[TextureTypes_Count];
 	unsigned int textureIDs[TextureTypes_Count];
+	//the model's material table and this material's range of it, filled in by the renderer once it is uploaded
+	unsigned int uniformBufferID;
+	unsigned int uniformOffset;
+
+	//approximate number of bytes of CPU memory used by this material
+	size_t getMemoryUsage() const;
 };
 
+inline size_t OBJMaterial::getMemoryUsage() const
+{
+	size_t bytes = sizeof(OBJMaterial) + name.capacity();
+	for (int i = 0; i < TextureTypes_Count; ++i)
+	{
+		bytes += textureFileNames[i].capacity();
+	}
+	return bytes;
+}
+
 //An OBJ Model can be composed of many meshes. Much like any 3D model
 //lets use a class to store individual mesh data
 class OBJMesh
@@ -85,24 +103,117 @@ public:
 	OBJMesh();
 	~OBJMesh();
 
+	//largest vertex count that is drawn with 16 bit indices, 0xFFFF itself is left free for primitive restart
+	static const unsigned int MaxShortIndexVertices = 0xFFFF;
+
+	static glm::vec4 calculateFaceNormal(const glm::vec4& a_positionA, const glm::vec4& a_positionB, const glm::vec4& a_positionC);
 	glm::vec4 calculateFaceNormal(const unsigned int& a_indexA, const unsigned int& a_indexB, const unsigned int& a_indexC) const;
 	void calculateFaceNormals();
+	//approximate number of bytes of CPU memory used by this mesh
+	size_t getMemoryUsage() const;
+	//the scans of a spilled mesh below release the pages they read as they go, so they aren't const
+	//average distance in texture coordinates covered by one unit of model space, used to pick the mip level a mesh needs
+	float calculateUVDensity();
+	//the smallest axis aligned box in model space that contains every vertex of the mesh
+	void calculateBoundingBox(glm::vec3& a_minimum, glm::vec3& a_maximum);
+	//a sphere in model space that contains every vertex of the mesh, centred on its bounding box a_minimum to a_maximum
+	void calculateBoundingSphere(const glm::vec3& a_minimum, const glm::vec3& a_maximum, glm::vec3& a_centre, float& a_radius);
+	//a simplified copy of the mesh for software occlusion culling, made of its largest triangles as a list of three
+	//positions per triangle. Leaving triangles out only ever hides less, so the copy never hides anything the mesh wouldn't
+	//a spilled mesh releases the pages it reads as it goes, the copy is left empty if they can't be mapped again
+	void calculateOccluder(std::vector<glm::vec3>& a_triangles, unsigned int a_maxTriangles);
+
+	//move the vertex and index output of this mesh into disk backed arrays (used for out-of-core loading)
+	bool spillToDisk(const std::string& a_directory);
+	bool isSpilled() const { return m_mappedVertices != nullptr; }
+	//release resident pages of disk backed data back to the operating system
+	//these return false if the disk backed storage could not be grown or mapped again
+	bool trim();
+	//append vertex and index data to whichever storage this mesh is using
+	bool appendVertices(const OBJVertex* a_vertices, unsigned int a_count);
+	bool appendIndices(const unsigned int* a_indices, unsigned int a_count);
+
+	//merge identical vertices and remap the indices to match (in memory meshes only)
+	void weldVertices();
+	//split the triangles of this mesh into new meshes that each have few enough vertices for 16 bit indices
+	void splitForShortIndices(std::vector<OBJMesh*>& a_meshes) const;
+	//move the indices into 16 bit storage if every vertex can be addressed, returns true if the mesh uses 16 bit indices
+	bool compressIndices();
+
+	//access vertex and index data regardless of where it is stored
+	const OBJVertex* getVertexData() const { return isSpilled() ? m_mappedVertices->data() : m_vertices.data(); }
+	unsigned int getVertexCount() const { return isSpilled() ? (unsigned int)m_mappedVertices->size() : (unsigned int)m_vertices.size(); }
+	//index data is either 16 or 32 bits per index, use getIndexSize to tell which
+	const void* getIndexData() const;
+	unsigned int getIndexCount() const;
+	unsigned int getIndexSize() const { return usesShortIndices() ? sizeof(unsigned short) : sizeof(unsigned int); }
+	bool usesShortIndices() const { return !isSpilled() && !m_shortIndicies.empty(); }
 
 	std::string m_name;
 	std::vector<OBJVertex> m_vertices;
 	std::vector<unsigned int> m_indicies;
+	//16 bit indices, used in place of m_indicies once the mesh has been compressed
+	std::vector<unsigned short> m_shortIndicies;
+	//disk backed storage used in place of the vectors above when the mesh has been spilled to disk
+	MappedArray<OBJVertex>* m_mappedVertices;
+	MappedArray<unsigned int>* m_mappedIndicies;
 
 	OBJMaterial* m_material;
+
+	//GPU handles for this mesh, filled in by the renderer once the mesh data is uploaded
+	unsigned int m_vertexArrayID;
+	unsigned int m_vertexBufferID;
+	unsigned int m_indexBufferID;
+	//a tightly packed copy of the positions alone and the vertex array the depth prepass reads it through
+	unsigned int m_depthVertexArrayID;
+	unsigned int m_positionBufferID;
+	//where the renderer's shared mesh pool holds a copy of this mesh, if it does
+	unsigned int m_poolBaseVertex;
+	unsigned int m_poolFirstIndex;
+	bool m_inMeshPool;
+	//texture streaming data, filled in by the renderer at the same time
+	float m_uvDensity;
+	glm::vec3 m_boundsCentre;
+	float m_boundsRadius;
+	//half the size of the model space bounding box, which is centred on m_boundsCentre, used for frustum culling
+	glm::vec3 m_boundsExtents;
+	//the triangles the mesh is drawn with when it hides other meshes from the software occlusion culler
+	std::vector<glm::vec3> m_occluderTriangles;
 };
 
 //inline constructor destructor -- to be expanded upon as required
-inline OBJMesh::OBJMesh() {}
-inline OBJMesh::~OBJMesh() {}
+inline OBJMesh::OBJMesh() : m_name(), m_vertices(), m_indicies(), m_shortIndicies(), m_mappedVertices(nullptr), m_mappedIndicies(nullptr), m_material(nullptr),
+	m_vertexArrayID(0), m_vertexBufferID(0), m_indexBufferID(0), m_depthVertexArrayID(0), m_positionBufferID(0), m_poolBaseVertex(0), m_poolFirstIndex(0), m_inMeshPool(false), m_uvDensity(0.0f), m_boundsCentre(0.0f), m_boundsRadius(0.0f), m_boundsExtents(0.0f), m_occluderTriangles() {}
+inline OBJMesh::~OBJMesh()
+{
+	delete m_mappedVertices;
+	delete m_mappedIndicies;
+}
+
+inline size_t OBJMesh::getMemoryUsage() const
+{
+	//count capacity rather than size as that is what the vectors have actually allocated
+	//disk backed data is not counted as the operating system is free to page it out
+	return sizeof(OBJMesh) + m_name.capacity() + m_vertices.capacity() * sizeof(OBJVertex) + m_indicies.capacity() * sizeof(unsigned int) +
+		m_shortIndicies.capacity() * sizeof(unsigned short) + m_occluderTriangles.capacity() * sizeof(glm::vec3);
+}
+
+inline const void* OBJMesh::getIndexData() const
+{
+	if (isSpilled()) { return m_mappedIndicies->data(); }
+	return usesShortIndices() ? (const void*)m_shortIndicies.data() : (const void*)m_indicies.data();
+}
+
+inline unsigned int OBJMesh::getIndexCount() const
+{
+	if (isSpilled()) { return (unsigned int)m_mappedIndicies->size(); }
+	return usesShortIndices() ? (unsigned int)m_shortIndicies.size() : (unsigned int)m_indicies.size();
+}
 
 class OBJModel
 {
 public:
-	OBJModel() : m_worldMatrix(glm::mat4(1.0f)), m_path(), m_meshes() {};
+	OBJModel() : m_worldMatrix(glm::mat4(1.0f)), m_path(), m_meshes(), m_outOfCore(false), m_memoryCap(0), m_scratchDirectory(), m_splitMeshes(false), m_geometryCache(false) {};
 	~OBJModel()
 	{
 		unload(); //function to inload any data loaded in from file
@@ -110,8 +221,25 @@ public:
 
 	//load from file location
 	bool load(const char* a_filename, float a_scale = 0.1f);
+	//out-of-core loading spills attribute data and mesh output to disk backed memory-mapped arrays
+	//and keeps resident memory under a_memoryCap bytes, for OBJ files that are too large to hold in memory
+	void setOutOfCore(bool a_enabled, size_t a_memoryCap = 256 * 1024 * 1024, const std::string& a_scratchDirectory = "");
+	bool isOutOfCore() const { return m_outOfCore; }
+	size_t getMemoryCap() const { return m_memoryCap; }
+	const std::string& getScratchDirectory() const { return m_scratchDirectory; }
+	//split meshes with more than OBJMesh::MaxShortIndexVertices vertices so every mesh can use 16 bit indices
+	//meshes that are small enough use 16 bit indices whether or not this is enabled
+	void setSplitMeshes(bool a_enabled) { m_splitMeshes = a_enabled; }
+	bool isSplittingMeshes() const { return m_splitMeshes; }
+	//keep a compressed copy of the loaded meshes next to the OBJ file (<file>.geocache), later loads read
+	//the cache instead of parsing the OBJ for as long as the OBJ is unchanged. Out-of-core loads don't use it
+	void setGeometryCache(bool a_enabled) { m_geometryCache = a_enabled; }
+	bool isUsingGeometryCache() const { return m_geometryCache; }
 	//function to unload and free memory
 	void unload();
+	//exchange all loaded data with another model, used to replace a model with a freshly loaded copy
+	//without invalidating pointers that are held to it
+	void swap(OBJModel& a_other);
 	//functions to retrieve path, number of meshes and world matrix of model
 	const char* getPath() const { return m_path.c_str(); }
 	unsigned int getMeshCount() const { return m_meshes.size(); }
@@ -131,6 +259,11 @@ private:
 	std::vector<std::string> splitStringAtCharacter(std::string data, char a_character);
 
 	void LoadMaterialLibrary(std::string a_mtllib);
+	//weld, split and compress the indices of the in memory meshes once loading has finished
+	void finaliseMeshes();
+	//read or write the compressed geometry cache for an OBJ file
+	bool loadGeometryCache(const std::string& a_filename, float a_scale);
+	void saveGeometryCache(const std::string& a_filename, float a_scale) const;
 
 	//obj face triplet struct
 	typedef struct obj_face_triplet
@@ -143,10 +276,18 @@ private:
 	obj_face_triplet ProcessTriplet(std::string a_triplet);
 
 	std::vector<OBJMaterial*> m_materials;
+	//material libraries referenced by the OBJ file, stored in the geometry cache
+	std::vector<std::string> m_materialLibraries;
 	//vector to storem esh data
 	std::vector<OBJMesh*> m_meshes;
 	//path to model data - useful for things like texture lookups
 	std::string m_path;
 	//root mat4 world matrix
 	glm::mat4 m_worldMatrix;
+	//out-of-core loading settings
+	bool m_outOfCore;
+	size_t m_memoryCap;
+	std::string m_scratchDirectory;
+	bool m_splitMeshes;
+	bool m_geometryCache;
 };
\ No newline at end of file
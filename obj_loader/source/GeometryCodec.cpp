@@ -0,0 +1,345 @@
+#include "GeometryCodec.h"
+#include "obj_Loader.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEOMETRY_CODEC_SSE2
+#endif
+
+//number of quantised components stored per vertex - position xyz, normal xyz and uv
+//position w is always 1 and normal w is always 0 so they are not stored
+static const unsigned int s_vertexComponents = 8;
+//largest quantised value of each component, positions and uvs keep 16 bits of precision while normals
+//only need 12 bits (under 0.03 degrees of error) which saves a quarter of their size
+static const float s_quantisedMax[s_vertexComponents] = { 65535.0f, 65535.0f, 65535.0f, 4095.0f, 4095.0f, 4095.0f, 65535.0f, 65535.0f };
+//set in a block's bit width byte when the block holds the values themselves rather than deltas
+static const unsigned int s_directFlag = 0x80;
+
+//helper functions to append and read plain values from a byte stream
+template<typename T>
+static void writeValue(std::vector<unsigned char>& a_output, const T& a_value)
+{
+	const unsigned char* bytes = (const unsigned char*)&a_value;
+	a_output.insert(a_output.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static bool readValue(const unsigned char*& a_data, const unsigned char* a_end, T& a_value)
+{
+	if ((size_t)(a_end - a_data) < sizeof(T)) { return false; }
+	memcpy(&a_value, a_data, sizeof(T));
+	a_data += sizeof(T);
+	return true;
+}
+
+//the value of component a_component of a vertex, in the order the components are stored
+static float vertexComponent(const OBJVertex& a_vertex, unsigned int a_component)
+{
+	switch (a_component)
+	{
+	case 0: return a_vertex.position.x;
+	case 1: return a_vertex.position.y;
+	case 2: return a_vertex.position.z;
+	case 3: return a_vertex.normal.x;
+	case 4: return a_vertex.normal.y;
+	case 5: return a_vertex.normal.z;
+	case 6: return a_vertex.uvcoord.x;
+	default: return a_vertex.uvcoord.y;
+	}
+}
+
+void GeometryCodec::encodeVertices(const OBJVertex* a_vertices, unsigned int a_count, std::vector<unsigned char>& a_output)
+{
+	//find the range of each component so the quantised values cover it exactly
+	float minimum[s_vertexComponents];
+	float maximum[s_vertexComponents];
+	for (unsigned int c = 0; c < s_vertexComponents; ++c)
+	{
+		minimum[c] = (a_count > 0) ? vertexComponent(a_vertices[0], c) : 0.0f;
+		maximum[c] = minimum[c];
+	}
+	for (unsigned int i = 1; i < a_count; ++i)
+	{
+		for (unsigned int c = 0; c < s_vertexComponents; ++c)
+		{
+			float value = vertexComponent(a_vertices[i], c);
+			minimum[c] = (value < minimum[c]) ? value : minimum[c];
+			maximum[c] = (value > maximum[c]) ? value : maximum[c];
+		}
+	}
+
+	//header - vertex count followed by the dequantisation offset and step for each component
+	writeValue(a_output, a_count);
+	float step[s_vertexComponents];
+	for (unsigned int c = 0; c < s_vertexComponents; ++c)
+	{
+		step[c] = (maximum[c] - minimum[c]) / s_quantisedMax[c];
+		writeValue(a_output, minimum[c]);
+		writeValue(a_output, step[c]);
+	}
+
+	//quantise and encode a block of vertices at a time, one packed block per component
+	unsigned int previous[s_vertexComponents] = {};
+	unsigned int quantised[BlockSize];
+	for (unsigned int first = 0; first < a_count; first += BlockSize)
+	{
+		unsigned int count = (a_count - first < BlockSize) ? a_count - first : BlockSize;
+		for (unsigned int c = 0; c < s_vertexComponents; ++c)
+		{
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				float value = (step[c] > 0.0f) ? (vertexComponent(a_vertices[first + i], c) - minimum[c]) / step[c] : 0.0f;
+				value = (value < 0.0f) ? 0.0f : (value > s_quantisedMax[c]) ? s_quantisedMax[c] : value;
+				quantised[i] = (unsigned int)(value + 0.5f);
+			}
+			encodeBlock(quantised, count, previous[c], a_output);
+		}
+	}
+}
+
+void GeometryCodec::encodeIndices(const void* a_indices, unsigned int a_count, unsigned int a_indexSize, std::vector<unsigned char>& a_output)
+{
+	writeValue(a_output, a_count);
+
+	//welded meshes number their vertices in the order they are first used, so each index is either the next
+	//unused vertex or one used recently. Indices are stored as the zigzagged distance back from the next unused
+	//vertex, which is 0 for a new vertex and small for a recent one
+	unsigned int nextVertex = 0;
+	unsigned int previous = 0;
+	unsigned int values[BlockSize];
+	for (unsigned int first = 0; first < a_count; first += BlockSize)
+	{
+		unsigned int count = (a_count - first < BlockSize) ? a_count - first : BlockSize;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			unsigned int index = (a_indexSize == sizeof(unsigned short)) ? ((const unsigned short*)a_indices)[first + i] : ((const unsigned int*)a_indices)[first + i];
+			int distance = (int)(nextVertex - index);
+			values[i] = ((unsigned int)distance << 1) ^ (unsigned int)(distance >> 31);
+			nextVertex = (index >= nextVertex) ? index + 1 : nextVertex;
+		}
+		encodeBlock(values, count, previous, a_output);
+	}
+}
+
+bool GeometryCodec::decodeVertices(const unsigned char*& a_data, const unsigned char* a_end, std::vector<OBJVertex>& a_vertices)
+{
+	unsigned int count = 0;
+	float minimum[s_vertexComponents];
+	float step[s_vertexComponents];
+	if (!readValue(a_data, a_end, count)) { return false; }
+	for (unsigned int c = 0; c < s_vertexComponents; ++c)
+	{
+		if (!readValue(a_data, a_end, minimum[c]) || !readValue(a_data, a_end, step[c])) { return false; }
+	}
+	//each block of vertices takes at least one byte per component, reject counts the data can't hold. The sum is
+	//done in size_t so a corrupt count near the top of the range can't wrap to a small one
+	if (((size_t)count + BlockSize - 1) / BlockSize * s_vertexComponents > (size_t)(a_end - a_data)) { return false; }
+
+	a_vertices.resize(count);
+	unsigned int previous[s_vertexComponents] = {};
+	unsigned int quantised[s_vertexComponents][BlockSize];
+	for (size_t first = 0; first < count; first += BlockSize)
+	{
+		for (unsigned int c = 0; c < s_vertexComponents; ++c)
+		{
+			if (!decodeBlock(a_data, a_end, previous[c], quantised[c])) { return false; }
+		}
+		unsigned int blockCount = (count - first < BlockSize) ? (unsigned int)(count - first) : BlockSize;
+		OBJVertex* pVertex = &a_vertices[first];
+		for (unsigned int i = 0; i < blockCount; ++i, ++pVertex)
+		{
+			pVertex->position = glm::vec4(minimum[0] + quantised[0][i] * step[0], minimum[1] + quantised[1][i] * step[1], minimum[2] + quantised[2][i] * step[2], 1.0f);
+			pVertex->normal = glm::vec4(minimum[3] + quantised[3][i] * step[3], minimum[4] + quantised[4][i] * step[4], minimum[5] + quantised[5][i] * step[5], 0.0f);
+			pVertex->uvcoord = glm::vec2(minimum[6] + quantised[6][i] * step[6], minimum[7] + quantised[7][i] * step[7]);
+		}
+	}
+	return true;
+}
+
+bool GeometryCodec::decodeIndices(const unsigned char*& a_data, const unsigned char* a_end, unsigned int a_vertexCount, std::vector<unsigned int>& a_indices)
+{
+	unsigned int count = 0;
+	if (!readValue(a_data, a_end, count)) { return false; }
+	if (((size_t)count + BlockSize - 1) / BlockSize > (size_t)(a_end - a_data)) { return false; }
+
+	a_indices.resize(count);
+	unsigned int nextVertex = 0;
+	unsigned int previous = 0;
+	unsigned int values[BlockSize];
+	for (size_t first = 0; first < count; first += BlockSize)
+	{
+		if (!decodeBlock(a_data, a_end, previous, values)) { return false; }
+		//turn the distances back from the next unused vertex into indices
+		unsigned int blockCount = (count - first < BlockSize) ? (unsigned int)(count - first) : BlockSize;
+		unsigned int* pIndex = &a_indices[first];
+		for (unsigned int i = 0; i < blockCount; ++i)
+		{
+			unsigned int distance = (values[i] >> 1) ^ (0u - (values[i] & 1));
+			unsigned int index = nextVertex - distance;
+			//an index past the end of the vertices would be read out of bounds by the GPU
+			if (index >= a_vertexCount) { return false; }
+			pIndex[i] = index;
+			nextVertex = (index >= nextVertex) ? index + 1 : nextVertex;
+		}
+	}
+	return true;
+}
+
+//number of bits needed to store every value that has been or'd together into a_used
+static unsigned int bitsNeeded(unsigned int a_used)
+{
+	unsigned int bits = 0;
+	while (bits < 32 && (a_used >> bits) != 0) { ++bits; }
+	return bits;
+}
+
+void GeometryCodec::encodeBlock(const unsigned int* a_values, unsigned int a_count, unsigned int& a_previous, std::vector<unsigned char>& a_output)
+{
+	//zigzag encode the difference to the previous value so small negative steps stay small, unused slots are zero
+	unsigned int deltas[BlockSize] = {};
+	unsigned int direct[BlockSize] = {};
+	unsigned int usedDeltas = 0;
+	unsigned int usedDirect = 0;
+	unsigned int previous = a_previous;
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		int delta = (int)(a_values[i] - previous);
+		deltas[i] = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+		direct[i] = a_values[i];
+		previous = a_values[i];
+		usedDeltas |= deltas[i];
+		usedDirect |= direct[i];
+	}
+	//pad a partial block with the last value so the padding costs nothing in either form
+	for (unsigned int i = a_count; i < BlockSize && a_count > 0; ++i)
+	{
+		direct[i] = previous;
+	}
+	a_previous = previous;
+
+	//the whole block is packed with the number of bits needed by its largest value, stored as deltas unless
+	//the values themselves are smaller (when consecutive values are unrelated), which is flagged in the top bit
+	unsigned int deltaBits = bitsNeeded(usedDeltas);
+	unsigned int directBits = bitsNeeded(usedDirect);
+	bool useDirect = directBits < deltaBits;
+	unsigned int bits = useDirect ? directBits : deltaBits;
+
+	size_t offset = a_output.size();
+	a_output.resize(offset + 1 + bits * 16);
+	a_output[offset] = (unsigned char)(bits | (useDirect ? s_directFlag : 0));
+	packBlock(useDirect ? direct : deltas, bits, &a_output[offset + 1]);
+}
+
+bool GeometryCodec::decodeBlock(const unsigned char*& a_data, const unsigned char* a_end, unsigned int& a_previous, unsigned int* a_values)
+{
+	if (a_data >= a_end) { return false; }
+	unsigned int bits = *a_data & ~s_directFlag;
+	bool direct = (*a_data++ & s_directFlag) != 0;
+	if (bits > 32 || (size_t)(a_end - a_data) < bits * 16) { return false; }
+	unpackBlock(a_data, bits, a_values);
+	a_data += bits * 16;
+	if (direct)
+	{
+		a_previous = a_values[BlockSize - 1];
+		return true;
+	}
+
+	//undo the zigzag encoding and sum the deltas back into values
+#ifdef GEOMETRY_CODEC_SSE2
+	const __m128i one = _mm_set1_epi32(1);
+	__m128i previous = _mm_set1_epi32((int)a_previous);
+	for (unsigned int i = 0; i < BlockSize; i += 4)
+	{
+		__m128i value = _mm_loadu_si128((const __m128i*)(a_values + i));
+		value = _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, one)));
+		//inclusive prefix sum of the 4 lanes, then add the last value of the previous group
+		value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+		value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+		value = _mm_add_epi32(value, previous);
+		_mm_storeu_si128((__m128i*)(a_values + i), value);
+		previous = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+	a_previous = (unsigned int)_mm_cvtsi128_si32(previous);
+#else
+	for (unsigned int i = 0; i < BlockSize; ++i)
+	{
+		unsigned int delta = (a_values[i] >> 1) ^ (0u - (a_values[i] & 1));
+		a_previous += delta;
+		a_values[i] = a_previous;
+	}
+#endif
+	return true;
+}
+
+//packed blocks hold 4 interleaved lanes, value i is in lane i % 4 and lane l fills every 4th 32 bit word
+//starting at word l, so one 128 bit load reads the same word of every lane
+void GeometryCodec::packBlock(const unsigned int* a_values, unsigned int a_bits, unsigned char* a_output)
+{
+	unsigned int words[BlockSize] = {};
+	for (unsigned int i = 0; i < BlockSize && a_bits > 0; ++i)
+	{
+		unsigned int lane = i % 4;
+		unsigned int bitPosition = (i / 4) * a_bits;
+		unsigned int word = bitPosition / 32;
+		unsigned int shift = bitPosition % 32;
+		words[word * 4 + lane] |= a_values[i] << shift;
+		if (shift + a_bits > 32)
+		{
+			words[(word + 1) * 4 + lane] |= a_values[i] >> (32 - shift);
+		}
+	}
+	memcpy(a_output, words, a_bits * 16);
+}
+
+void GeometryCodec::unpackBlock(const unsigned char* a_input, unsigned int a_bits, unsigned int* a_values)
+{
+	if (a_bits == 0)
+	{
+		memset(a_values, 0, BlockSize * sizeof(unsigned int));
+		return;
+	}
+#ifdef GEOMETRY_CODEC_SSE2
+	const __m128i* pInput = (const __m128i*)a_input;
+	const __m128i mask = _mm_set1_epi32((a_bits == 32) ? -1 : (int)((1u << a_bits) - 1));
+	__m128i current = _mm_loadu_si128(pInput++);
+	unsigned int shift = 0;
+	for (unsigned int i = 0; i < BlockSize; i += 4)
+	{
+		__m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128((int)shift));
+		shift += a_bits;
+		if (shift >= 32)
+		{
+			//the value ends in, or exactly at the end of, the current word
+			shift -= 32;
+			if (i + 4 < BlockSize || shift > 0)
+			{
+				current = _mm_loadu_si128(pInput++);
+				if (shift > 0)
+				{
+					value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128((int)(a_bits - shift))));
+				}
+			}
+		}
+		_mm_storeu_si128((__m128i*)(a_values + i), _mm_and_si128(value, mask));
+	}
+#else
+	unsigned int words[BlockSize];
+	memcpy(words, a_input, a_bits * 16);
+	const unsigned int mask = (a_bits == 32) ? 0xFFFFFFFF : (1u << a_bits) - 1;
+	for (unsigned int i = 0; i < BlockSize; ++i)
+	{
+		unsigned int lane = i % 4;
+		unsigned int bitPosition = (i / 4) * a_bits;
+		unsigned int word = bitPosition / 32;
+		unsigned int shift = bitPosition % 32;
+		unsigned int value = words[word * 4 + lane] >> shift;
+		if (shift + a_bits > 32)
+		{
+			value |= words[(word + 1) * 4 + lane] << (32 - shift);
+		}
+		a_values[i] = value & mask;
+	}
+#endif
+}
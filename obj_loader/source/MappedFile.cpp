@@ -0,0 +1,182 @@
+#include "MappedFile.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//counter used to give each backing file created by this process a unique name
+static std::atomic<unsigned int> s_fileCounter(0);
+
+#ifdef _WIN32
+MappedFile::MappedFile() : m_open(false), m_data(nullptr), m_size(0), m_fileHandle(nullptr), m_mappingHandle(nullptr) {}
+#else
+MappedFile::MappedFile() : m_open(false), m_data(nullptr), m_size(0), m_fileDescriptor(-1) {}
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& a_directory)
+{
+	close();
+
+	//build a unique file name for this process in the requested directory
+	std::string directory = a_directory;
+	if (directory.empty())
+	{
+#ifdef _WIN32
+		char tempPath[MAX_PATH + 1];
+		DWORD length = GetTempPathA(MAX_PATH + 1, tempPath);
+		directory = (length > 0) ? std::string(tempPath, length) : ".";
+#else
+		const char* tempPath = getenv("TMPDIR");
+		directory = (tempPath != nullptr) ? tempPath : "/tmp";
+#endif
+	}
+	if (directory.back() != '/' && directory.back() != '\\')
+	{
+		directory += "/";
+	}
+#ifdef _WIN32
+	int processID = _getpid();
+#else
+	int processID = getpid();
+#endif
+	std::string path = directory + "obj_spill_" + std::to_string(processID) + "_" + std::to_string(s_fileCounter++) + ".tmp";
+
+#ifdef _WIN32
+	//the file is temporary and removed by the OS once the last handle to it is closed
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "Unable to create spill file: " << path << std::endl;
+		return false;
+	}
+	m_fileHandle = file;
+#else
+	m_fileDescriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (m_fileDescriptor < 0)
+	{
+		std::cout << "Unable to create spill file: " << path << std::endl;
+		return false;
+	}
+	//unlink straight away, the file lives until the descriptor is closed
+	unlink(path.c_str());
+#endif
+	m_open = true;
+	m_size = 0;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (!m_open) { return; }
+	unmap();
+#ifdef _WIN32
+	CloseHandle((HANDLE)m_fileHandle);
+	m_fileHandle = nullptr;
+#else
+	::close(m_fileDescriptor);
+	m_fileDescriptor = -1;
+#endif
+	m_size = 0;
+	m_open = false;
+}
+
+bool MappedFile::resize(size_t a_bytes)
+{
+	if (!m_open) { return false; }
+	unmap();
+#ifdef _WIN32
+	LARGE_INTEGER fileSize;
+	fileSize.QuadPart = (LONGLONG)a_bytes;
+	if (!SetFilePointerEx((HANDLE)m_fileHandle, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile((HANDLE)m_fileHandle))
+	{
+		std::cout << "Unable to resize spill file" << std::endl;
+		return false;
+	}
+#else
+	if (ftruncate(m_fileDescriptor, (off_t)a_bytes) != 0)
+	{
+		std::cout << "Unable to resize spill file" << std::endl;
+		return false;
+	}
+#endif
+	m_size = a_bytes;
+	return map();
+}
+
+bool MappedFile::trim()
+{
+	if (m_data == nullptr) { return m_size == 0; }
+#ifdef _WIN32
+	//unmapping the view removes its pages from the working set, dirty pages are written to the file. The view is
+	//mapped again at the same address so pointers into it stay valid, if that address has been taken it fails
+	void* address = m_data;
+	unmap();
+	return map(address);
+#else
+	//for a shared file mapping this drops the pages from the process, the contents remain in the file
+	madvise(m_data, m_size, MADV_DONTNEED);
+	return true;
+#endif
+}
+
+bool MappedFile::map(void* a_address)
+{
+	if (m_size == 0) { return true; }
+#ifdef _WIN32
+	DWORD sizeHigh = (DWORD)((unsigned long long)m_size >> 32);
+	DWORD sizeLow = (DWORD)(m_size & 0xFFFFFFFF);
+	m_mappingHandle = CreateFileMappingA((HANDLE)m_fileHandle, nullptr, PAGE_READWRITE, sizeHigh, sizeLow, nullptr);
+	if (m_mappingHandle != nullptr)
+	{
+		m_data = MapViewOfFileEx((HANDLE)m_mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, m_size, a_address);
+	}
+#else
+	(void)a_address;
+	void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fileDescriptor, 0);
+	m_data = (data != MAP_FAILED) ? data : nullptr;
+#endif
+	if (m_data == nullptr)
+	{
+		std::cout << "Unable to map spill file" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::unmap()
+{
+#ifdef _WIN32
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mappingHandle != nullptr)
+	{
+		CloseHandle((HANDLE)m_mappingHandle);
+		m_mappingHandle = nullptr;
+	}
+#else
+	if (m_data != nullptr)
+	{
+		munmap(m_data, m_size);
+	}
+#endif
+	m_data = nullptr;
+}
@@ -1,12 +1,73 @@
 #include "obj_Loader.h"
+#include "GeometryCodec.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iterator>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <sys/stat.h>
+
+//identifies a geometry cache file and the version of its layout
+static const char s_geometryCacheMagic[4] = { 'O', 'G', 'C', '1' };
+//number of triangles or vertices of a spilled mesh a scan reads between releasing the pages that have been read
+static const unsigned int s_scanTrimTriangles = 1 << 20;
+static const unsigned int s_scanTrimVertices = 1 << 18;
+
+//hash for OBJVertex so identical vertices can be found with an unordered_map, FNV-1a over the vertex bytes
+//which matches the memcmp based comparison operators
+struct OBJVertexHash
+{
+	size_t operator()(const OBJVertex& a_vertex) const
+	{
+		const unsigned char* bytes = (const unsigned char*)&a_vertex;
+		size_t hash = 2166136261u;
+		for (size_t i = 0; i < sizeof(OBJVertex); ++i)
+		{
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+		return hash;
+	}
+};
 
 void OBJModel::unload()
 {
+	for (auto iter = m_meshes.begin(); iter != m_meshes.end(); ++iter)
+	{
+		delete *iter;
+	}
 	m_meshes.clear();
+	for (auto iter = m_materials.begin(); iter != m_materials.end(); ++iter)
+	{
+		delete *iter;
+	}
+	m_materials.clear();
+	m_materialLibraries.clear();
+}
+
+void OBJModel::swap(OBJModel& a_other)
+{
+	std::swap(m_materials, a_other.m_materials);
+	std::swap(m_materialLibraries, a_other.m_materialLibraries);
+	std::swap(m_meshes, a_other.m_meshes);
+	std::swap(m_path, a_other.m_path);
+	std::swap(m_worldMatrix, a_other.m_worldMatrix);
+	std::swap(m_outOfCore, a_other.m_outOfCore);
+	std::swap(m_memoryCap, a_other.m_memoryCap);
+	std::swap(m_scratchDirectory, a_other.m_scratchDirectory);
+	std::swap(m_splitMeshes, a_other.m_splitMeshes);
+	std::swap(m_geometryCache, a_other.m_geometryCache);
+}
+
+void OBJModel::setOutOfCore(bool a_enabled, size_t a_memoryCap, const std::string& a_scratchDirectory)
+{
+	m_outOfCore = a_enabled;
+	m_memoryCap = a_memoryCap;
+	m_scratchDirectory = a_scratchDirectory;
 }
 
 bool OBJModel::load(const char* a_filename, float a_scale)
@@ -32,6 +93,13 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 		}
 		m_path = filePath;
 
+		//a valid geometry cache holds the result of parsing this file, use it instead
+		if (m_geometryCache && !m_outOfCore && loadGeometryCache(a_filename, a_scale))
+		{
+			file.close();
+			return true;
+		}
+
 		//success file has been opened, verify contents of file -- i.e. check that file is not zero length
 		file.ignore(std::numeric_limits<std::streamsize>::max()); //attempt to read the highest number of bytes from the file
 		std::streamsize fileSize = file.gcount(); //gCount will have reached EOF marker, letting us know number of bytes
@@ -54,13 +122,31 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 
 		OBJMesh* currentMesh = nullptr;
 		std::string fileLine;
-		std::vector<glm::vec4> vertexData;
-		std::vector<glm::vec4> normalData;
-		std::vector<glm::vec2> UVData;
+		MappedArray<glm::vec4> vertexData;
+		MappedArray<glm::vec4> normalData;
+		MappedArray<glm::vec2> UVData;
+		//scratch storage for the vertices and indices of the face currently being processed
+		std::vector<OBJVertex> faceVertices;
+		std::vector<unsigned int> faceIndices;
+
+		//when loading out-of-core the attribute pools and mesh output live in memory-mapped files
+		//faces are processed in windows, once a window's worth of data has been touched all mapped pages
+		//are released back to the OS which keeps the resident set under the memory cap
+		size_t windowBytes = m_memoryCap / 4;
+		size_t bytesInWindow = 0;
+		//set if a backing file can't be grown or mapped (disk full, out of address space), the load is abandoned
+		bool storageFailed = false;
+		if (m_outOfCore)
+		{
+			std::cout << "Out-of-core loading enabled, memory cap: " << m_memoryCap / (float)(1024 * 1024) << "MB" << std::endl;
+			vertexData.spillToDisk(m_scratchDirectory);
+			normalData.spillToDisk(m_scratchDirectory);
+			UVData.spillToDisk(m_scratchDirectory);
+		}
 		//store our material in a string as face data is not generated prior to material assignment and may not have a mesh
 		OBJMaterial* currentMtl = nullptr;
 		//set up reading in chunks of a file at a time
-		while (!file.eof())
+		while (!file.eof() && !storageFailed)
 		{
 			if (std::getline(file, fileLine))
 			{
@@ -81,6 +167,7 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 						std::cout << "Material File: " << data << std::endl;
 						//load in material file so that materials can be used as required
 						LoadMaterialLibrary(data);
+						m_materialLibraries.push_back(data);
 						continue;
 					}
 					if (dataType == "g" || dataType == "o") //data group
@@ -93,6 +180,7 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 						}
 						currentMesh = new OBJMesh();
 						currentMesh->m_name = data;
+						if (m_outOfCore) { currentMesh->spillToDisk(m_scratchDirectory); }
 						if (currentMtl != nullptr) //if we have a material name
 						{
 							currentMesh->m_material = currentMtl;
@@ -104,21 +192,21 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 						glm::vec4 vertex = processVectorString(data);
 						vertex *= a_scale; //multiply by passed in vector to allow scaling of model
 						vertex.w = 1.0f; //as this is position data ensure the w component is set to 1.0
-						vertexData.push_back(vertex);
+						storageFailed = !vertexData.push_back(vertex);
 						continue;
 					}
 					if (dataType == "vt") //texture coordinate
 					{
 						glm::vec4 uvCoordv4 = processVectorString(data);
 						glm::vec2 uvCoord = glm::vec2(uvCoordv4.x, uvCoordv4.y);
-						UVData.push_back(uvCoord);
+						storageFailed = !UVData.push_back(uvCoord);
 						continue;
 					}
 					if (dataType == "vn") //vertex normal
 					{
 						glm::vec4 normal = processVectorString(data);
 						normal.w = 0.0f;
-						normalData.push_back(normal);
+						storageFailed = !normalData.push_back(normal);
 						continue;
 					}
 					if (dataType == "f") //face data - multiple verticies
@@ -126,6 +214,7 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 						if (currentMesh == nullptr) //we have entered processing faces without having hit a 'o' or 'g' tag
 						{
 							currentMesh = new OBJMesh();
+							if (m_outOfCore) { currentMesh->spillToDisk(m_scratchDirectory); }
 							if (currentMtl != nullptr) //if we have a material name
 							{
 								currentMesh->m_material = currentMtl;
@@ -135,7 +224,9 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 						//process face data
 						//face consists of 3 -> more vertices split at ' ' then at '/' characters
 						std::vector<std::string> faceData = splitStringAtCharacter(data, ' ');
-						unsigned int ci = currentMesh->m_vertices.size();
+						unsigned int ci = currentMesh->getVertexCount();
+						faceVertices.clear();
+						faceIndices.clear();
 						for (auto iter = faceData.begin(); iter != faceData.end(); ++iter)
 						{
 							//process face triplet
@@ -151,7 +242,7 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 							{
 								currentVertex.uvcoord = UVData[triplet.vt - 1];
 							}
-							currentMesh->m_vertices.push_back(currentVertex);
+							faceVertices.push_back(currentVertex);
 						}
 						//all face information for the tri/quad/fan have been collected
 						//time to index these into the current mesh
@@ -159,15 +250,36 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 						bool calcNormals = normalData.empty();
 						for (unsigned int offset = 1; offset < (faceData.size() - 1); ++offset)
 						{
-							currentMesh->m_indicies.push_back(ci);
-							currentMesh->m_indicies.push_back(ci + offset);
-							currentMesh->m_indicies.push_back(ci + 1 + offset);
+							faceIndices.push_back(ci);
+							faceIndices.push_back(ci + offset);
+							faceIndices.push_back(ci + 1 + offset);
 							if (calcNormals) //if we need to calculate normals we can do that here
 							{
-								glm::vec4 normal = currentMesh->calculateFaceNormal(ci, ci + offset, ci + offset + 1);
-								currentMesh->m_vertices[ci].normal = normal;
-								currentMesh->m_vertices[ci + offset].normal = normal;
-								currentMesh->m_vertices[ci + offset + 1].normal = normal;
+								glm::vec4 normal = OBJMesh::calculateFaceNormal(faceVertices[0].position, faceVertices[offset].position, faceVertices[offset + 1].position);
+								faceVertices[0].normal = normal;
+								faceVertices[offset].normal = normal;
+								faceVertices[offset + 1].normal = normal;
+							}
+						}
+						if (!currentMesh->appendVertices(faceVertices.data(), (unsigned int)faceVertices.size()) ||
+							!currentMesh->appendIndices(faceIndices.data(), (unsigned int)faceIndices.size()))
+						{
+							storageFailed = true;
+							continue;
+						}
+
+						if (m_outOfCore)
+						{
+							//count the attribute reads and the mesh output written for this face towards the current window
+							bytesInWindow += faceVertices.size() * (sizeof(glm::vec4) * 2 + sizeof(glm::vec2) + sizeof(OBJVertex)) + faceIndices.size() * sizeof(unsigned int);
+							if (bytesInWindow >= windowBytes)
+							{
+								storageFailed = !vertexData.trim() || !normalData.trim() || !UVData.trim() || !currentMesh->trim();
+								for (auto meshIter = m_meshes.begin(); meshIter != m_meshes.end(); ++meshIter)
+								{
+									storageFailed = !(*meshIter)->trim() || storageFailed;
+								}
+								bytesInWindow = 0;
 							}
 						}
 						continue;
@@ -192,17 +304,38 @@ bool OBJModel::load(const char* a_filename, float a_scale)
 		{
 			m_meshes.push_back(currentMesh);
 		}
+		finaliseMeshes();
+		if (m_outOfCore)
+		{
+			//the attribute pools are released as they go out of scope, only the mesh output is kept on disk
+			for (auto meshIter = m_meshes.begin(); meshIter != m_meshes.end(); ++meshIter)
+			{
+				storageFailed = !(*meshIter)->trim() || storageFailed;
+			}
+		}
+		if (storageFailed)
+		{
+			//the mapped output can't be trusted past this point, nothing from the file is kept
+			std::cout << "Out-of-core storage failed, abandoning load of: " << a_filename << std::endl;
+			unload();
+			file.close();
+			return false;
+		}
+		if (!m_outOfCore && m_geometryCache)
+		{
+			saveGeometryCache(a_filename, a_scale);
+		}
 		file.close();
 		return true;
 	}
 	return false;
 }
 
-glm::vec4 OBJMesh::calculateFaceNormal(const unsigned int& a_indexA, const unsigned int& a_indexB, const unsigned int& a_indexC) const
+glm::vec4 OBJMesh::calculateFaceNormal(const glm::vec4& a_positionA, const glm::vec4& a_positionB, const glm::vec4& a_positionC)
 {
-	glm::vec3 a = m_vertices[a_indexA].position;
-	glm::vec3 b = m_vertices[a_indexB].position;
-	glm::vec3 c = m_vertices[a_indexC].position;
+	glm::vec3 a = a_positionA;
+	glm::vec3 b = a_positionB;
+	glm::vec3 c = a_positionC;
 
 	glm::vec3 ab = glm::normalize(b - a);
 	glm::vec3 ac = glm::normalize(c - a);
@@ -210,6 +343,11 @@ glm::vec4 OBJMesh::calculateFaceNormal(const unsigned int& a_indexA, const unsig
 	return glm::vec4(glm::cross(ab, ac), 0.0f);
 }
 
+glm::vec4 OBJMesh::calculateFaceNormal(const unsigned int& a_indexA, const unsigned int& a_indexB, const unsigned int& a_indexC) const
+{
+	return calculateFaceNormal(m_vertices[a_indexA].position, m_vertices[a_indexB].position, m_vertices[a_indexC].position);
+}
+
 void OBJMesh::calculateFaceNormals()
 {
 	//as our indexed triangle Array contains a tri for each three points we can iterate through this vector and calculate a face normal
@@ -221,6 +359,462 @@ void OBJMesh::calculateFaceNormals()
 	}
 }
 
+float OBJMesh::calculateUVDensity()
+{
+	//compare the total area of the triangles in texture space and in model space
+	const OBJVertex* vertices = getVertexData();
+	const void* indices = getIndexData();
+	bool shortIndices = usesShortIndices();
+	double uvArea = 0.0, modelArea = 0.0;
+	for (unsigned int i = 0, count = getIndexCount(), triangles = 0; i + 2 < count; i += 3)
+	{
+		//a spilled mesh releases the pages it has read as it goes, which may map the data at a new address
+		if (isSpilled() && ++triangles == s_scanTrimTriangles)
+		{
+			triangles = 0;
+			if (!trim()) { return 0.0f; }
+			vertices = getVertexData();
+			indices = getIndexData();
+		}
+		unsigned int triangle[3];
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			triangle[j] = shortIndices ? ((const unsigned short*)indices)[i + j] : ((const unsigned int*)indices)[i + j];
+		}
+		const OBJVertex& a = vertices[triangle[0]];
+		const OBJVertex& b = vertices[triangle[1]];
+		const OBJVertex& c = vertices[triangle[2]];
+		glm::vec2 uvAB = b.uvcoord - a.uvcoord, uvAC = c.uvcoord - a.uvcoord;
+		uvArea += fabs(uvAB.x * uvAC.y - uvAB.y * uvAC.x) * 0.5;
+		modelArea += glm::length(glm::cross(glm::vec3(b.position - a.position), glm::vec3(c.position - a.position))) * 0.5;
+	}
+	if (isSpilled())
+	{
+		trim();
+	}
+	//areas scale with the square of lengths
+	return (modelArea > 0.0) ? (float)sqrt(uvArea / modelArea) : 0.0f;
+}
+
+void OBJMesh::calculateBoundingBox(glm::vec3& a_minimum, glm::vec3& a_maximum)
+{
+	const OBJVertex* vertices = getVertexData();
+	unsigned int count = getVertexCount();
+	a_minimum = a_maximum = glm::vec3(0.0f);
+	if (count == 0) { return; }
+	a_minimum = a_maximum = glm::vec3(vertices[0].position);
+	for (unsigned int i = 1; i < count; ++i)
+	{
+		//a spilled mesh releases the pages it has read as it goes, which may map the data at a new address
+		if (isSpilled() && i % s_scanTrimVertices == 0)
+		{
+			if (!trim()) { return; }
+			vertices = getVertexData();
+		}
+		a_minimum = glm::min(a_minimum, glm::vec3(vertices[i].position));
+		a_maximum = glm::max(a_maximum, glm::vec3(vertices[i].position));
+	}
+	if (isSpilled())
+	{
+		trim();
+	}
+}
+
+void OBJMesh::calculateBoundingSphere(const glm::vec3& a_minimum, const glm::vec3& a_maximum, glm::vec3& a_centre, float& a_radius)
+{
+	//centre the sphere on the bounding box, then grow it to reach the furthest vertex
+	const OBJVertex* vertices = getVertexData();
+	unsigned int count = getVertexCount();
+	a_centre = (a_minimum + a_maximum) * 0.5f;
+	a_radius = 0.0f;
+	if (count == 0) { return; }
+	float radiusSquared = 0.0f;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (isSpilled() && i > 0 && i % s_scanTrimVertices == 0)
+		{
+			if (!trim()) { return; }
+			vertices = getVertexData();
+		}
+		glm::vec3 offset = glm::vec3(vertices[i].position) - a_centre;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	a_radius = sqrtf(radiusSquared);
+	if (isSpilled())
+	{
+		trim();
+	}
+}
+
+void OBJMesh::calculateOccluder(std::vector<glm::vec3>& a_triangles, unsigned int a_maxTriangles)
+{
+	//rank the triangles by area and keep the largest, those are the walls, floors and table tops that hide things
+	//a min heap holds the largest found so far, so the smallest of them is the one replaced by a larger triangle
+	typedef std::pair<float, unsigned int> RankedTriangle;
+	std::priority_queue<RankedTriangle, std::vector<RankedTriangle>, std::greater<RankedTriangle>> largest;
+	a_triangles.clear();
+	if (a_maxTriangles == 0) { return; }
+
+	const OBJVertex* vertices = getVertexData();
+	const void* indices = getIndexData();
+	bool shortIndices = usesShortIndices();
+	for (unsigned int i = 0, count = getIndexCount(), triangles = 0; i + 2 < count; i += 3)
+	{
+		//a spilled mesh releases the pages it has read as it goes, which may map the data at a new address
+		if (isSpilled() && ++triangles == s_scanTrimTriangles)
+		{
+			triangles = 0;
+			if (!trim()) { return; }
+			vertices = getVertexData();
+			indices = getIndexData();
+		}
+		unsigned int triangle[3];
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			triangle[j] = shortIndices ? ((const unsigned short*)indices)[i + j] : ((const unsigned int*)indices)[i + j];
+		}
+		glm::vec3 a = glm::vec3(vertices[triangle[0]].position), b = glm::vec3(vertices[triangle[1]].position), c = glm::vec3(vertices[triangle[2]].position);
+		float area = glm::length(glm::cross(b - a, c - a));
+		if (area <= 0.0f) { continue; }
+		if (largest.size() < a_maxTriangles)
+		{
+			largest.push(std::make_pair(area, i));
+		}
+		else if (area > largest.top().first)
+		{
+			largest.pop();
+			largest.push(std::make_pair(area, i));
+		}
+	}
+
+	//the heap hands the triangles back smallest first
+	a_triangles.resize(largest.size() * 3);
+	for (size_t n = largest.size(); n-- > 0; largest.pop())
+	{
+		for (unsigned int j = 0; j < 3; ++j)
+		{
+			unsigned int i = largest.top().second + j;
+			unsigned int index = shortIndices ? ((const unsigned short*)indices)[i] : ((const unsigned int*)indices)[i];
+			a_triangles[n * 3 + j] = glm::vec3(vertices[index].position);
+		}
+	}
+	if (isSpilled())
+	{
+		trim();
+	}
+}
+
+bool OBJMesh::spillToDisk(const std::string& a_directory)
+{
+	if (isSpilled()) { return true; }
+	m_mappedVertices = new MappedArray<OBJVertex>();
+	m_mappedIndicies = new MappedArray<unsigned int>();
+	if (!m_mappedVertices->spillToDisk(a_directory) || !m_mappedIndicies->spillToDisk(a_directory))
+	{
+		//fall back to keeping the data in memory
+		delete m_mappedVertices;
+		delete m_mappedIndicies;
+		m_mappedVertices = nullptr;
+		m_mappedIndicies = nullptr;
+		return false;
+	}
+	//move across any data that was added before spilling
+	if (!m_mappedVertices->append(m_vertices.data(), m_vertices.size()) || !m_mappedIndicies->append(m_indicies.data(), m_indicies.size()))
+	{
+		//the in memory copy is still intact, keep using it
+		delete m_mappedVertices;
+		delete m_mappedIndicies;
+		m_mappedVertices = nullptr;
+		m_mappedIndicies = nullptr;
+		return false;
+	}
+	std::vector<OBJVertex>().swap(m_vertices);
+	std::vector<unsigned int>().swap(m_indicies);
+	return true;
+}
+
+bool OBJMesh::trim()
+{
+	if (isSpilled())
+	{
+		bool vertices = m_mappedVertices->trim();
+		bool indices = m_mappedIndicies->trim();
+		return vertices && indices;
+	}
+	return true;
+}
+
+bool OBJMesh::appendVertices(const OBJVertex* a_vertices, unsigned int a_count)
+{
+	if (isSpilled())
+	{
+		return m_mappedVertices->append(a_vertices, a_count);
+	}
+	m_vertices.insert(m_vertices.end(), a_vertices, a_vertices + a_count);
+	return true;
+}
+
+bool OBJMesh::appendIndices(const unsigned int* a_indices, unsigned int a_count)
+{
+	if (isSpilled())
+	{
+		return m_mappedIndicies->append(a_indices, a_count);
+	}
+	m_indicies.insert(m_indicies.end(), a_indices, a_indices + a_count);
+	return true;
+}
+
+void OBJMesh::weldVertices()
+{
+	if (isSpilled() || m_vertices.empty()) { return; }
+
+	//faces are added with their own copy of every vertex, keep the first copy of each distinct vertex
+	std::unordered_map<OBJVertex, unsigned int, OBJVertexHash> lookup;
+	lookup.reserve(m_vertices.size());
+	std::vector<OBJVertex> vertices;
+	vertices.reserve(m_vertices.size());
+	std::vector<unsigned int> remap(m_vertices.size());
+	for (size_t i = 0; i < m_vertices.size(); ++i)
+	{
+		auto result = lookup.emplace(m_vertices[i], (unsigned int)vertices.size());
+		if (result.second)
+		{
+			vertices.push_back(m_vertices[i]);
+		}
+		remap[i] = result.first->second;
+	}
+	for (auto iter = m_indicies.begin(); iter != m_indicies.end(); ++iter)
+	{
+		*iter = remap[*iter];
+	}
+	//copy rather than swap so the vertex vector doesn't hold on to the unused capacity
+	m_vertices.assign(vertices.begin(), vertices.end());
+}
+
+void OBJMesh::splitForShortIndices(std::vector<OBJMesh*>& a_meshes) const
+{
+	const unsigned int unassigned = 0xFFFFFFFF;
+	//index of each source vertex in the current chunk, and the source vertices used by the chunk so they can be reset
+	std::vector<unsigned int> remap(m_vertices.size(), unassigned);
+	std::vector<unsigned int> used;
+	OBJMesh* pChunk = nullptr;
+	unsigned int chunkCount = 0;
+	for (size_t i = 0; i + 2 < m_indicies.size(); i += 3)
+	{
+		//start a new chunk when this triangle could take the current one over the limit
+		if (pChunk == nullptr || pChunk->m_vertices.size() + 3 > MaxShortIndexVertices)
+		{
+			for (auto iter = used.begin(); iter != used.end(); ++iter)
+			{
+				remap[*iter] = unassigned;
+			}
+			used.clear();
+			pChunk = new OBJMesh();
+			pChunk->m_name = m_name + "_" + std::to_string(chunkCount++);
+			pChunk->m_material = m_material;
+			a_meshes.push_back(pChunk);
+		}
+		for (size_t n = i; n < i + 3; ++n)
+		{
+			unsigned int source = m_indicies[n];
+			if (remap[source] == unassigned)
+			{
+				remap[source] = (unsigned int)pChunk->m_vertices.size();
+				pChunk->m_vertices.push_back(m_vertices[source]);
+				used.push_back(source);
+			}
+			pChunk->m_indicies.push_back(remap[source]);
+		}
+	}
+}
+
+bool OBJMesh::compressIndices()
+{
+	if (isSpilled() || m_indicies.empty() || m_vertices.size() > MaxShortIndexVertices) { return usesShortIndices(); }
+	m_shortIndicies.assign(m_indicies.begin(), m_indicies.end());
+	std::vector<unsigned int>().swap(m_indicies);
+	return true;
+}
+
+void OBJModel::finaliseMeshes()
+{
+	std::vector<OBJMesh*> meshes;
+	for (auto iter = m_meshes.begin(); iter != m_meshes.end(); ++iter)
+	{
+		OBJMesh* pMesh = *iter;
+		//out-of-core meshes are too large to process in memory, they keep their 32 bit indices
+		if (pMesh->isSpilled())
+		{
+			meshes.push_back(pMesh);
+			continue;
+		}
+		pMesh->weldVertices();
+		if (m_splitMeshes && pMesh->getVertexCount() > OBJMesh::MaxShortIndexVertices)
+		{
+			std::cout << "Splitting mesh " << pMesh->m_name << " (" << pMesh->getVertexCount() << " vertices) for 16 bit indices" << std::endl;
+			pMesh->splitForShortIndices(meshes);
+			delete pMesh;
+			continue;
+		}
+		meshes.push_back(pMesh);
+	}
+	for (auto iter = meshes.begin(); iter != meshes.end(); ++iter)
+	{
+		(*iter)->compressIndices();
+	}
+	m_meshes.swap(meshes);
+}
+
+//helper functions for reading and writing the geometry cache
+template<typename T>
+static void writeCacheValue(std::vector<unsigned char>& a_output, const T& a_value)
+{
+	const unsigned char* bytes = (const unsigned char*)&a_value;
+	a_output.insert(a_output.end(), bytes, bytes + sizeof(T));
+}
+
+static void writeCacheString(std::vector<unsigned char>& a_output, const std::string& a_value)
+{
+	writeCacheValue(a_output, (unsigned int)a_value.size());
+	a_output.insert(a_output.end(), a_value.begin(), a_value.end());
+}
+
+template<typename T>
+static bool readCacheValue(const unsigned char*& a_data, const unsigned char* a_end, T& a_value)
+{
+	if ((size_t)(a_end - a_data) < sizeof(T)) { return false; }
+	memcpy(&a_value, a_data, sizeof(T));
+	a_data += sizeof(T);
+	return true;
+}
+
+static bool readCacheString(const unsigned char*& a_data, const unsigned char* a_end, std::string& a_value)
+{
+	unsigned int length = 0;
+	if (!readCacheValue(a_data, a_end, length) || (size_t)(a_end - a_data) < length) { return false; }
+	a_value.assign((const char*)a_data, length);
+	a_data += length;
+	return true;
+}
+
+//the size and modification time of the OBJ file, stored in the cache to tell when it is out of date
+static bool getSourceFileInfo(const std::string& a_filename, long long& a_size, long long& a_modifiedTime)
+{
+	struct stat info;
+	if (stat(a_filename.c_str(), &info) != 0) { return false; }
+	a_size = (long long)info.st_size;
+	a_modifiedTime = (long long)info.st_mtime;
+	return true;
+}
+
+bool OBJModel::loadGeometryCache(const std::string& a_filename, float a_scale)
+{
+	long long sourceSize = 0, sourceTime = 0;
+	if (!getSourceFileInfo(a_filename, sourceSize, sourceTime)) { return false; }
+
+	std::ifstream cacheFile(a_filename + ".geocache", std::ios_base::in | std::ios_base::binary);
+	if (!cacheFile.is_open()) { return false; }
+	std::vector<unsigned char> cache((std::istreambuf_iterator<char>(cacheFile)), std::istreambuf_iterator<char>());
+	cacheFile.close();
+
+	const unsigned char* data = cache.data();
+	const unsigned char* end = data + cache.size();
+	char magic[4];
+	long long cacheSize = 0, cacheTime = 0;
+	float scale = 0.0f;
+	unsigned char splitMeshes = 0;
+	if (!readCacheValue(data, end, magic) || memcmp(magic, s_geometryCacheMagic, sizeof(magic)) != 0 ||
+		!readCacheValue(data, end, cacheSize) || !readCacheValue(data, end, cacheTime) ||
+		!readCacheValue(data, end, scale) || !readCacheValue(data, end, splitMeshes))
+	{
+		return false;
+	}
+	//the cache is only valid for the same version of the file loaded with the same settings
+	if (cacheSize != sourceSize || cacheTime != sourceTime || scale != a_scale || (splitMeshes != 0) != m_splitMeshes)
+	{
+		std::cout << "Geometry cache is out of date: " << a_filename << ".geocache" << std::endl;
+		return false;
+	}
+
+	bool success = true;
+	unsigned int libraryCount = 0;
+	success = readCacheValue(data, end, libraryCount);
+	for (unsigned int i = 0; success && i < libraryCount; ++i)
+	{
+		std::string library;
+		success = readCacheString(data, end, library);
+		if (success)
+		{
+			LoadMaterialLibrary(library);
+			m_materialLibraries.push_back(library);
+		}
+	}
+
+	unsigned int meshCount = 0;
+	success = success && readCacheValue(data, end, meshCount);
+	for (unsigned int i = 0; success && i < meshCount; ++i)
+	{
+		OBJMesh* pMesh = new OBJMesh();
+		m_meshes.push_back(pMesh);
+		std::string materialName;
+		success = readCacheString(data, end, pMesh->m_name) && readCacheString(data, end, materialName) &&
+			GeometryCodec::decodeVertices(data, end, pMesh->m_vertices) && GeometryCodec::decodeIndices(data, end, (unsigned int)pMesh->m_vertices.size(), pMesh->m_indicies);
+		if (success)
+		{
+			pMesh->m_material = materialName.empty() ? nullptr : getMaterialByName(materialName.c_str());
+			pMesh->compressIndices();
+		}
+	}
+
+	if (!success)
+	{
+		//discard anything read from the damaged cache, the OBJ file will be parsed instead
+		std::cout << "Geometry cache is damaged: " << a_filename << ".geocache" << std::endl;
+		unload();
+		return false;
+	}
+	std::cout << "Loaded geometry from cache: " << a_filename << ".geocache" << std::endl;
+	return true;
+}
+
+void OBJModel::saveGeometryCache(const std::string& a_filename, float a_scale) const
+{
+	long long sourceSize = 0, sourceTime = 0;
+	if (!getSourceFileInfo(a_filename, sourceSize, sourceTime)) { return; }
+
+	std::vector<unsigned char> cache;
+	cache.insert(cache.end(), s_geometryCacheMagic, s_geometryCacheMagic + sizeof(s_geometryCacheMagic));
+	writeCacheValue(cache, sourceSize);
+	writeCacheValue(cache, sourceTime);
+	writeCacheValue(cache, a_scale);
+	writeCacheValue(cache, (unsigned char)(m_splitMeshes ? 1 : 0));
+
+	writeCacheValue(cache, (unsigned int)m_materialLibraries.size());
+	for (auto iter = m_materialLibraries.begin(); iter != m_materialLibraries.end(); ++iter)
+	{
+		writeCacheString(cache, *iter);
+	}
+
+	writeCacheValue(cache, (unsigned int)m_meshes.size());
+	for (auto iter = m_meshes.begin(); iter != m_meshes.end(); ++iter)
+	{
+		const OBJMesh* pMesh = *iter;
+		writeCacheString(cache, pMesh->m_name);
+		writeCacheString(cache, (pMesh->m_material != nullptr) ? pMesh->m_material->name : std::string());
+		GeometryCodec::encodeVertices(pMesh->getVertexData(), pMesh->getVertexCount(), cache);
+		GeometryCodec::encodeIndices(pMesh->getIndexData(), pMesh->getIndexCount(), pMesh->getIndexSize(), cache);
+	}
+
+	std::ofstream cacheFile(a_filename + ".geocache", std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!cacheFile.is_open())
+	{
+		std::cout << "Unable to write geometry cache: " << a_filename << ".geocache" << std::endl;
+		return;
+	}
+	cacheFile.write((const char*)cache.data(), cache.size());
+	std::cout << "Geometry cache written: " << a_filename << ".geocache (" << cache.size() / 1024 << "KB)" << std::endl;
+}
+
 std::string OBJModel::lineType(const std::string& a_in)
 {
 	if (!a_in.empty())
@@ -257,6 +851,8 @@ std::string OBJModel::lineData(const std::string& a_in)
 	{
 		return a_in.substr(data_start);
 	}
+	//line has a type token but no data
+	return "";
 }
 
 glm::vec4 OBJModel::processVectorString(const std::string a_data)
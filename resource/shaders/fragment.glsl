@@ -1,10 +0,0 @@
-#version 400 
- 
-smooth in vec4 vertColour; 
- 
-out vec4 outputColour; 
-
-void main() 
-{ 
-	outputColour = vertColour; 
-}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#version 420 
+
+smooth in vec3 nearPoint;
+smooth in vec3 farPoint;
+
+out vec4 outputColour; 
+
+//per frame data, written once a frame by the renderer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 ProjectionViewMatrix;
+	vec4 camPos;
+	vec4 lightDir;
+};
+
+//distances from the camera over which the grid fades out
+const float FadeStart = 40.0;
+const float FadeEnd = 150.0;
+
+void main() 
+{ 
+	//where the view ray meets the ground plane, pixels looking above the horizon have no grid
+	float t = -nearPoint.y / (farPoint.y - nearPoint.y);
+	if (t <= 0.0)
+	{
+		discard;
+	}
+	vec3 groundPos = nearPoint + t * (farPoint - nearPoint);
+
+	//lines one unit apart, measured in pixels using the screen space rate of change so they stay a pixel wide at any
+	//distance and their edges are blended rather than stepped
+	vec2 coord = groundPos.xz;
+	vec2 pixelSize = max(fwidth(coord), vec2(1e-6));
+	vec2 lineDistance = abs(fract(coord - 0.5) - 0.5) / pixelSize;
+	float coverage = 1.0 - min(min(lineDistance.x, lineDistance.y), 1.0);
+
+	//the lines along the X axis are red and along the Z axis blue, the rest are black
+	vec3 colour = vec3(0.0);
+	if (abs(groundPos.z) / pixelSize.y < 1.0)
+	{
+		colour = vec3(1.0, 0.2, 0.2);
+	}
+	else if (abs(groundPos.x) / pixelSize.x < 1.0)
+	{
+		colour = vec3(0.2, 0.4, 1.0);
+	}
+
+	//fade with distance, and where cells shrink towards a pixel across so far away lines don't shimmer
+	float fade = 1.0 - smoothstep(FadeStart, FadeEnd, length(groundPos - camPos.xyz));
+	fade *= 1.0 - smoothstep(0.25, 0.5, max(pixelSize.x, pixelSize.y));
+	float alpha = coverage * fade;
+	if (alpha <= 0.0)
+	{
+		discard;
+	}
+
+	//the grid is tested against the depth of the scene at the point on the ground it shows
+	vec4 clipPos = ProjectionViewMatrix * vec4(groundPos, 1.0);
+	gl_FragDepth = (clipPos.z / clipPos.w) * 0.5 + 0.5;
+	outputColour = vec4(colour, alpha);
+}
@@ -0,0 +1,27 @@
+#version 420 
+
+//one triangle covering the whole screen, the grid is worked out for each pixel from where its view ray meets the ground
+const vec2 corners[3] = vec2[3](vec2(-1.0, -1.0), vec2(3.0, -1.0), vec2(-1.0, 3.0));
+
+//the points on the near and far planes behind the pixel, interpolated linearly as both planes face the screen
+smooth out vec3 nearPoint;
+smooth out vec3 farPoint;
+
+//per frame data, written once a frame by the renderer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 ProjectionViewMatrix;
+	vec4 camPos;
+	vec4 lightDir;
+};
+
+void main() 
+{ 
+	vec2 corner = corners[gl_VertexID];
+	mat4 inverseProjectionView = inverse(ProjectionViewMatrix);
+	vec4 nearCorner = inverseProjectionView * vec4(corner, -1.0, 1.0);
+	vec4 farCorner = inverseProjectionView * vec4(corner, 1.0, 1.0);
+	nearPoint = nearCorner.xyz / nearCorner.w;
+	farPoint = farCorner.xyz / farCorner.w;
+	gl_Position = vec4(corner, 0.0, 1.0);
+}
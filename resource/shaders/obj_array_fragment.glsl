@@ -0,0 +1,66 @@
+#version 420 
+ 
+smooth in vec4 vertPos;
+smooth in vec4 vertNormal;
+smooth in vec2 vertUV;
+
+out vec4 outputColour; 
+
+//per frame data, written once a frame by the renderer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 ProjectionViewMatrix;
+	vec4 camPos;
+	vec4 lightDir;
+};
+
+//the material's colours, a range of the model's material table
+layout(std140, binding = 1) uniform MaterialData
+{
+	vec4 kA;
+	vec4 kD;
+	vec4 kS;
+};
+
+//uniforms for texture data, each texture is a layer of a texture array
+uniform sampler2DArray DiffuseTexture;
+uniform sampler2DArray SpecularTexture;
+uniform sampler2DArray NormalTexture;
+//the layer of each texture in its array, -1 if the material doesn't have the texture
+uniform ivec3 TextureLayers;
+
+vec3 iA = vec3(0.25f, 0.25f, 0.25f);
+vec3 iD = vec3(1.0f, 1.0f, 1.0f);
+vec3 iS = vec3(1.0f, 1.0f, 1.0f);
+
+//missing textures sample black, the same as an unbound 2D texture
+vec4 sampleLayer(sampler2DArray a_texture, int a_layer)
+{
+	return (a_layer < 0) ? vec4(0.0f, 0.0f, 0.0f, 1.0f) : texture(a_texture, vec3(vertUV, a_layer));
+}
+
+void main() 
+{ 
+	//get texture data from UV coords
+	vec4 textureData = sampleLayer(NormalTexture, TextureLayers.z);
+	//compressed normal maps only store x and y, rebuild z so compressed and uncompressed maps match
+	//materials without a normal map sample black and are left as they are
+	if (textureData.b == 0.0f && any(notEqual(textureData.rg, vec2(0.0f))))
+	{
+		vec2 normalXY = textureData.rg * 2.0f - 1.0f;
+		textureData.b = sqrt(max(0.0f, 1.0f - dot(normalXY, normalXY))) * 0.5f + 0.5f;
+	}
+	vec3 Ambient = kA.xyz * iA; //ambient light
+
+	//get lambertian time
+	float nDl = max(0.0f, dot(normalize(vertNormal), -lightDir));
+	vec3 Diffuse = kD.xyz * iD * nDl * textureData.rgb;
+
+	vec3 R = reflect(lightDir, normalize(vertNormal)).xyz; //refracted light colour
+	vec3 E = normalize(camPos - vertPos).xyz; //surface to eye vector
+
+	float specTerm = pow(max(0.0f, dot(E, R)), kS.a); //specular term
+	vec3 Specular = kS.xyz * iS * specTerm;
+
+	outputColour = vec4(Ambient + Diffuse + Specular, 1.0f);
+}
\ No newline at end of file
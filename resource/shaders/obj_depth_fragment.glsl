@@ -0,0 +1,6 @@
+#version 420 
+
+//the depth prepass only writes depth, colour writes are masked off while it runs
+void main() 
+{ 
+}
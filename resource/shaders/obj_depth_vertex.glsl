@@ -0,0 +1,22 @@
+#version 420 
+ 
+//positions alone, the w of the three component stream is filled in as 1
+layout(location = 0) in vec4 position; 
+//world matrix of the instance being drawn, one per actor sharing the model
+layout(location = 3) in mat4 transform;
+
+//the main pass tests for depths equal to the ones written here, so both are computed the same way
+invariant gl_Position;
+ 
+//per frame data, written once a frame by the renderer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 ProjectionViewMatrix;
+	vec4 camPos;
+	vec4 lightDir;
+};
+
+void main() 
+{ 
+	gl_Position = ProjectionViewMatrix * transform * position; //screen space position
+}
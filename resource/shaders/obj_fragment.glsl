@@ -1,4 +1,4 @@
-#version 400 
+#version 420 
  
 smooth in vec4 vertPos;
 smooth in vec4 vertNormal;
@@ -6,11 +6,21 @@ smooth in vec2 vertUV;
 
 out vec4 outputColour; 
 
-uniform vec4 camPos;
-
-uniform vec4 kA;
-uniform vec4 kD;
-uniform vec4 kS;
+//per frame data, written once a frame by the renderer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 ProjectionViewMatrix;
+	vec4 camPos;
+	vec4 lightDir;
+};
+
+//the material's colours, a range of the model's material table
+layout(std140, binding = 1) uniform MaterialData
+{
+	vec4 kA;
+	vec4 kD;
+	vec4 kS;
+};
 
 //uniforms for texture data
 uniform sampler2D DiffuseTexture;
@@ -21,12 +31,17 @@ vec3 iA = vec3(0.25f, 0.25f, 0.25f);
 vec3 iD = vec3(1.0f, 1.0f, 1.0f);
 vec3 iS = vec3(1.0f, 1.0f, 1.0f);
 
-vec4 lightDir = normalize(vec4(0.0f) - vec4(10.0f, 8.0f, 10.0f, 0.0f));
-
 void main() 
 { 
 	//get texture data from UV coords
 	vec4 textureData = texture(NormalTexture, vertUV);
+	//compressed normal maps only store x and y, rebuild z so compressed and uncompressed maps match
+	//materials without a normal map sample black and are left as they are
+	if (textureData.b == 0.0f && any(notEqual(textureData.rg, vec2(0.0f))))
+	{
+		vec2 normalXY = textureData.rg * 2.0f - 1.0f;
+		textureData.b = sqrt(max(0.0f, 1.0f - dot(normalXY, normalXY))) * 0.5f + 0.5f;
+	}
 	vec3 Ambient = kA.xyz * iA; //ambient light
 
 	//get lambertian time
@@ -0,0 +1,34 @@
+#version 430
+//gl_DrawIDARB tells each draw of a multi-draw which entry of the draw data to read
+#extension GL_ARB_shader_draw_parameters : require 
+ 
+layout(location = 0) in vec4 position; 
+layout(location = 1) in vec4 normal;
+layout(location = 2) in vec2 uvCoord;
+//world matrix of the instance being drawn, one per actor sharing the model
+layout(location = 3) in mat4 transform;
+ 
+smooth out vec4 vertPos;
+smooth out vec4 vertNormal;
+smooth out vec2 vertUV;
+flat out int drawID;
+ 
+//per frame data, written once a frame by the renderer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 ProjectionViewMatrix;
+	vec4 camPos;
+	vec4 lightDir;
+};
+
+void main() 
+{ 
+	vertUV = uvCoord;
+	drawID = gl_DrawIDARB;
+	//actors are scaled the same on every axis, so the rotation part of the world matrix turns normals the same
+	//way the normal matrix would, the fragment shader normalises away the difference in length
+	vertNormal = vec4(mat3(transform) * normal.xyz, 0.0);
+
+	vertPos = transform * position; //world space position
+	gl_Position = ProjectionViewMatrix * transform * position; //screen space position
+} 
\ No newline at end of file